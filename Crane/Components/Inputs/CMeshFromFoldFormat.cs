@@ -32,6 +32,8 @@ namespace Crane.Components.Inputs
         protected override void RegisterOutputParams(GH_Component.GH_OutputParamManager pManager)
         {
             pManager.AddGenericParameter("CMesh", "CMesh", "CMesh", GH_ParamAccess.item);
+            pManager.AddGenericParameter("RigidOrigami", "RigidOrigami",
+                "RigidOrigami whose records are the frames in file_frames.", GH_ParamAccess.item);
         }
 
         /// <summary>
@@ -42,8 +44,18 @@ namespace Crane.Components.Inputs
         {
             string path = "";
             DA.GetData(0, ref path);
-            CMesh cMesh = FoldFormat.ReadFoldFormat(path).ToCMesh();
+            var frames = new List<MathNet.Numerics.LinearAlgebra.Vector<double>>();
+            CMesh cMesh = FoldReader.Read(path, frames).ToCMesh();
             DA.SetData(0, cMesh);
+
+            var rigidOrigami = new RigidOrigami(cMesh, new List<Constraint>());
+            if (frames.Count > 0)
+            {
+                // 記録の末尾から再生・追記できるように最後のフレームを指す
+                rigidOrigami.RecordedMeshPoints = frames;
+                rigidOrigami.NowRecordedIndexPosition = frames.Count - 1;
+            }
+            DA.SetData(1, rigidOrigami);
         }
 
         /// <summary>
@@ -0,0 +1,116 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using Crane.Core;
+using Grasshopper.Kernel;
+
+namespace Crane.Components.Outputs
+{
+    public class SolverTelemetryComponent : GH_Component
+    {
+        /// <summary>
+        /// Initializes a new instance of the SolverTelemetryComponent class.
+        /// </summary>
+        public SolverTelemetryComponent()
+          : base("Solver Telemetry", "Telemetry",
+              "Per-phase timings and counters of the rigid origami solver.",
+              "Crane", "Outputs")
+        {
+        }
+
+        /// <summary>
+        /// Registers all the input parameters for this component.
+        /// </summary>
+        protected override void RegisterInputParams(GH_Component.GH_InputParamManager pManager)
+        {
+            pManager.AddGenericParameter("Rigid Origami", "RO", "Rigid origami.", GH_ParamAccess.item);
+            pManager.AddBooleanParameter("Reset", "Reset", "Clear the recorded telemetry.", GH_ParamAccess.item, false);
+            pManager.AddTextParameter("Path", "Path",
+                "Path of the Chrome trace (.json) file. Turn on Trace of the solver to record the spans.", GH_ParamAccess.item);
+            pManager.AddBooleanParameter("Write", "Write", "Write the Chrome trace or not.", GH_ParamAccess.item, false);
+            pManager[1].Optional = true;
+            pManager[2].Optional = true;
+            pManager[3].Optional = true;
+        }
+
+        /// <summary>
+        /// Registers all the output parameters for this component.
+        /// </summary>
+        protected override void RegisterOutputParams(GH_Component.GH_OutputParamManager pManager)
+        {
+            pManager.AddTextParameter("Phase", "Phase", "Solver phases.", GH_ParamAccess.list);
+            pManager.AddIntegerParameter("Count", "Count", "Number of times each phase ran.", GH_ParamAccess.list);
+            pManager.AddNumberParameter("Total", "Total", "Total time of each phase in milliseconds.", GH_ParamAccess.list);
+            pManager.AddNumberParameter("Mean", "Mean", "Mean time of each phase in milliseconds.", GH_ParamAccess.list);
+            pManager.AddNumberParameter("Max", "Max", "Max time of each phase in milliseconds.", GH_ParamAccess.list);
+            pManager.AddTextParameter("Counters", "Counters", "Solver counters.", GH_ParamAccess.list);
+            pManager.AddTextParameter("Json", "Json", "Telemetry summary with histograms as JSON.", GH_ParamAccess.item);
+        }
+
+        /// <summary>
+        /// This is the method that actually does the work.
+        /// </summary>
+        /// <param name="DA">The DA object is used to retrieve from inputs and store in outputs.</param>
+        protected override void SolveInstance(IGH_DataAccess DA)
+        {
+            RigidOrigami rigidOrigami = null;
+            bool reset = false;
+            string path = "";
+            bool write = false;
+
+            if (!DA.GetData(0, ref rigidOrigami)) return;
+            DA.GetData(1, ref reset);
+            DA.GetData(2, ref path);
+            DA.GetData(3, ref write);
+
+            var telemetry = rigidOrigami.Telemetry;
+            if (reset) telemetry.Reset();
+
+            if (write)
+            {
+                if (string.IsNullOrEmpty(path))
+                    AddRuntimeMessage(GH_RuntimeMessageLevel.Warning, "Path is empty.");
+                else
+                {
+                    if (!telemetry.IsTracing)
+                        AddRuntimeMessage(GH_RuntimeMessageLevel.Remark, "Trace of the solver is off, so the trace has no spans.");
+                    telemetry.ExportChromeTrace(path);
+                }
+            }
+
+            var phases = Enum.GetValues(typeof(SolverPhase)).Cast<SolverPhase>()
+                .Select(telemetry.GetPhaseStatistics).ToList();
+            var counters = Enum.GetValues(typeof(SolverCounter)).Cast<SolverCounter>()
+                .Select(c => c.ToString() + " : " + telemetry.GetCounter(c)).ToList();
+
+            DA.SetDataList(0, phases.Select(p => p.Phase.ToString()));
+            DA.SetDataList(1, phases.Select(p => (int)p.Count));
+            DA.SetDataList(2, phases.Select(p => p.TotalMilliseconds));
+            DA.SetDataList(3, phases.Select(p => p.MeanMilliseconds));
+            DA.SetDataList(4, phases.Select(p => p.MaxMilliseconds));
+            DA.SetDataList(5, counters);
+            DA.SetData(6, telemetry.ToJson());
+        }
+
+        /// <summary>
+        /// Provides an Icon for the component.
+        /// </summary>
+        protected override System.Drawing.Bitmap Icon
+        {
+            get
+            {
+                //You can add image files to your project resources and access them like this:
+                // return Resources.IconForThisComponent;
+                return Properties.Resource.icons_solver_telemetry;
+            }
+        }
+
+        /// <summary>
+        /// Gets the unique ID for this component. Do not change this ID after release.
+        /// </summary>
+        public override Guid ComponentGuid
+        {
+            get { return new Guid("3c6f2b8e-5d41-4a7f-9e0c-8b2d1f6a4e93"); }
+        }
+    }
+}
@@ -30,8 +30,14 @@ namespace Crane.Components.Util
             pManager.AddBooleanParameter("FullFold", "FullFold", "Write 180 degree full fold for MV lines.",
                 GH_ParamAccess.item, false);
             pManager.AddBooleanParameter("Write", "Write", "Write or not.", GH_ParamAccess.item, false);
+            pManager.AddGenericParameter("RigidOrigami", "RigidOrigami",
+                "If given, its records are written to file_frames.", GH_ParamAccess.item);
+            pManager.AddBooleanParameter("Binary", "Binary",
+                "Also write a binary sidecar (path + \".bin\") for fast loading of large models.", GH_ParamAccess.item, false);
             pManager[2].Optional = true;
             pManager[3].Optional = true;
+            pManager[4].Optional = true;
+            pManager[5].Optional = true;
         }
 
         /// <summary>
@@ -56,11 +62,34 @@ namespace Crane.Components.Util
             DA.GetData(1, ref path);
             DA.GetData(2, ref fullFold);
             DA.GetData(3, ref write);
+            RigidOrigami rigidOrigami = null;
+            bool binary = false;
+            DA.GetData(4, ref rigidOrigami);
+            DA.GetData(5, ref binary);
 
             if (write)
             {
-                var foldFormat = cMesh.ToFoldFormat(fullFold);
-                File.WriteAllText(path, foldFormat);
+                var keyFrame = FoldFrame.FromCMesh(cMesh, fullFold, FoldFormat.ActiveDocumentUnit());
+                var records = rigidOrigami?.RecordedMeshPoints;
+                // 記録が空なら file_frames のない 1 フレームのファイルにする
+                if (records != null && records.Count == 0) records = null;
+                // JSON と sidecar のどちらにも書く前に、 すべての記録の頂点数を確かめる
+                int mismatch = records?.FindIndex(points => points.Count != 3 * keyFrame.VertexCount) ?? -1;
+                if (mismatch >= 0)
+                {
+                    AddRuntimeMessage(GH_RuntimeMessageLevel.Warning, $"Record {mismatch} does not match the CMesh, so the records are not written.");
+                    records = null;
+                }
+
+                using (var writer = new FoldWriter(path))
+                {
+                    writer.WriteKeyFrame(keyFrame, records != null);
+                    if (records != null)
+                    {
+                        foreach (var points in records) writer.AppendFrame(points);
+                    }
+                }
+                if (binary) FoldBinary.Write(path, keyFrame, records);
             }
         }
 
@@ -1,6 +1,7 @@
 ﻿using System;
 using System.Collections.Generic;
 using System.Linq;
+using System.Threading;
 using System.Windows.Forms;
 using Crane.Core;
 using GrasshopperAsyncComponent;
@@ -20,7 +21,7 @@ namespace Crane.Components.Solver
               "Description",
               "Crane", "Solver")
         {
-            BaseWorker = new CraneWorker();
+            BaseWorker = new CraneWorker(this);
         }
 
         /// <summary>
@@ -45,6 +46,13 @@ namespace Crane.Components.Solver
                 "If true, this enforce 180° folding angle constarint", GH_ParamAccess.item, true);
             pManager.AddBooleanParameter("Is Constraint", "Is Constraint",
                 "If true, this enforce additional constraints", GH_ParamAccess.item, true);
+            pManager.AddIntegerParameter("Progress Interval", "Progress Interval",
+                "CGNR iterations between two progress updates while solving. 0 updates only after each Newton step. " +
+                "The native solvers report progress and stop on cancel inside a CGNR solve only when they support recycling.",
+                GH_ParamAccess.item, 10);
+            pManager.AddBooleanParameter("Trace", "Trace",
+                "If true, record each solver phase span for the Chrome trace export of the Solver Telemetry component.",
+                GH_ParamAccess.item, false);
 
             pManager[1].Optional = true;
             pManager[2].Optional = true;
@@ -55,6 +63,8 @@ namespace Crane.Components.Solver
             pManager[7].Optional = true;
             pManager[8].Optional = true;
             pManager[9].Optional = true;
+            pManager[10].Optional = true;
+            pManager[11].Optional = true;
 
         }
 
@@ -90,12 +100,107 @@ namespace Crane.Components.Solver
             get { return new Guid("4719ED74-2739-4C1A-81A1-80E2787B93B7"); }
         }
 
+        /// <summary>
+        /// Vertex coordinates of the running solve. The worker publishes them after every Newton step
+        /// and the viewport preview reads the latest ones without blocking the worker.
+        /// </summary>
+        internal CoordinateDoubleBuffer Coordinates { get; } = new CoordinateDoubleBuffer();
+
+        private Mesh previewMesh;
+        private int previewGeneration;
+        private int previewVersion;
+        private double[] previewCoordinates;
+        private long lastRedraw;
+
+        /// <summary>
+        /// Called by the worker when a solve starts. The mesh is only used for its topology.
+        /// </summary>
+        internal void BeginPreview(Mesh mesh, int generation)
+        {
+            Volatile.Write(ref previewMesh, mesh);
+            Volatile.Write(ref previewGeneration, generation);
+        }
+
+        internal void EndPreview()
+        {
+            Volatile.Write(ref previewMesh, null);
+        }
+
+        /// <summary>
+        /// Called by the worker when its solve is cancelled. The preview is left alone if a newer solve
+        /// has already started, and the viewports are redrawn so the cancelled mesh disappears.
+        /// </summary>
+        internal void EndPreview(int generation)
+        {
+            if (Volatile.Read(ref previewGeneration) != generation) return;
+            EndPreview();
+            RequestPreviewRedraw(true);
+        }
+
+        /// <summary>
+        /// Redraws the viewports at most every 50 ms unless <paramref name="force"/> is set. Safe to call from the worker thread.
+        /// </summary>
+        internal void RequestPreviewRedraw(bool force = false)
+        {
+            long now = System.Diagnostics.Stopwatch.GetTimestamp();
+            if (force)
+            {
+                Interlocked.Exchange(ref lastRedraw, now);
+            }
+            else
+            {
+                long last = Interlocked.Read(ref lastRedraw);
+                if ((now - last) * 1000 < 50 * System.Diagnostics.Stopwatch.Frequency) return;
+                if (Interlocked.CompareExchange(ref lastRedraw, now, last) != last) return;
+            }
+            Rhino.RhinoApp.InvokeOnUiThread((Action)(() => Rhino.RhinoDoc.ActiveDoc?.Views.Redraw()));
+        }
+
+        private Mesh UpdatePreviewMesh()
+        {
+            var mesh = Volatile.Read(ref previewMesh);
+            if (mesh == null || Volatile.Read(ref previewGeneration) != Coordinates.Generation) return null;
+            if (Coordinates.TryRead(ref previewVersion, ref previewCoordinates)
+                && previewCoordinates.Length == 3 * mesh.Vertices.Count)
+            {
+                for (int i = 0; i < mesh.Vertices.Count; i++)
+                {
+                    mesh.Vertices.SetVertex(i, previewCoordinates[3 * i], previewCoordinates[3 * i + 1], previewCoordinates[3 * i + 2]);
+                }
+            }
+            return mesh;
+        }
+
+        public override bool IsPreviewCapable => true;
+
+        public override BoundingBox ClippingBox
+        {
+            get
+            {
+                var box = base.ClippingBox;
+                var mesh = Volatile.Read(ref previewMesh);
+                if (mesh != null) box.Union(mesh.GetBoundingBox(false));
+                return box;
+            }
+        }
+
+        public override void DrawViewportWires(IGH_PreviewArgs args)
+        {
+            base.DrawViewportWires(args);
+            var mesh = UpdatePreviewMesh();
+            if (mesh != null) args.Display.DrawMeshWires(mesh, args.WireColour);
+        }
+
         public override void AppendAdditionalMenuItems(ToolStripDropDown menu)
         {
             base.AppendAdditionalMenuItems(menu);
             Menu_AppendItem(menu, "Cancel", (s, e) =>
             {
                 RequestCancellation();
+                // 実行中の求解がまだ Publish しても表示されないように世代を進めてから消す
+                Coordinates.NextGeneration();
+                EndPreview();
+                RequestPreviewRedraw(true);
             });
         }
     }
@@ -114,15 +219,17 @@ namespace Crane.Components.Solver
         bool isPanelFlat = true;
         bool isFoldBlock = true;
         bool isConstraint = true;
+        int progressInterval = 10;
+        bool trace = false;
         double residual = 1e+10;
         RigidOrigami rigidOrigami = new RigidOrigami();
 
 
-        public CraneWorker() : base(null) { }
+        public CraneWorker(GH_Component parent) : base(parent) { }
 
         public override WorkerInstance Duplicate()
         { 
-            return new CraneWorker();
+            return new CraneWorker(Parent);
         }
 
         public override void DoWork(Action<string, double> ReportProgress, Action Done)
@@ -132,22 +239,58 @@ namespace Crane.Components.Solver
                 return;
             } 
             rigidOrigami = new RigidOrigami(cMesh, constraints);
+            rigidOrigami.Telemetry.IsTracing = trace;
             rigidOrigami.SaveModes(isRigid, isPanelFlat, isFoldBlock, isConstraint);
+            // 監視 (キャンセルと進捗) はリサイクル付きのネイティブソルバーにしか届かないので常に使う。
+            // 部分空間は Newton ステップをまたいで rigidOrigami のワークスペースに残る
+            rigidOrigami.IsRecycleMode = true;
             if (solve)
             {
+                var parent = Parent as CraneAsyncSolver;
+                // 古い求解の結果はここから先 Publish されても捨てられる
+                int generation = parent?.Coordinates.NextGeneration() ?? 0;
+                parent?.BeginPreview(rigidOrigami.CMesh.Mesh.DuplicateMesh(), generation);
+
                 var moveVector = Vector<double>.Build.Dense(rigidOrigami.CMesh.DOF);
                 int iteration = 0;
-                while (iteration < nrIteration && residual > threshold)
+                double progressResidual = 0;
+                using var monitor = new SolverMonitor(CancellationToken, (cgnrStep, cgnrResidual) =>
+                {
+                    double progressIteration = (iteration + Math.Min(1.0, (double)cgnrStep / cgnrIteration)) / nrIteration;
+                    ReportProgress(Id, Math.Max(progressIteration, progressResidual));
+                }, progressInterval);
+                rigidOrigami.Monitor = monitor;
+                try
+                {
+                    while (iteration < nrIteration && residual > threshold)
+                    {
+                        residual = rigidOrigami.NRSolve(moveVector, threshold, 1, cgnrIteration);
+                        parent?.Coordinates.Publish(rigidOrigami.CMesh.MeshVerticesVector, generation);
+                        parent?.RequestPreviewRedraw();
+
+                        double progressIteration, progress;
+                        progressIteration = (double)(iteration + 1) / (double)nrIteration;
+                        progressResidual = (new double[] {1, Math.Log10(residual)/Math.Log10(threshold)}).Min();
+                        progress = (new double[] { progressIteration, progressResidual }).Max();
+                        ReportProgress(Id, progress);
+                        iteration++;
+
+                        if (CancellationToken.IsCancellationRequested)
+                        {
+                            parent?.EndPreview(generation);
+                            return;
+                        }
+                    }
+                }
+                catch (OperationCanceledException)
+                {
+                    // 入力が変わった / キャンセルされた求解は結果を出さずに捨てる
+                    parent?.EndPreview(generation);
+                    return;
+                }
+                finally
                 {
-                    residual = rigidOrigami.NRSolve(moveVector, threshold, 1, cgnrIteration);
-                    double progressIteration, progressResidual, progress;
-                    progressIteration = (double)(iteration + 1) / (double)nrIteration;
-                    progressResidual = (new double[] {1, Math.Log10(residual)/Math.Log10(threshold)}).Min();
-                    progress = (new double[] { progressIteration, progressResidual }).Max();
-                    ReportProgress(Id, progress);
-                    iteration++;
-
-                    if (CancellationToken.IsCancellationRequested) return;
+                    rigidOrigami.Monitor = null;
                 }
             }
 
@@ -157,6 +300,7 @@ namespace Crane.Components.Solver
         public override void SetData(IGH_DataAccess DA)
         {
             if (CancellationToken.IsCancellationRequested) return;
+            (Parent as CraneAsyncSolver)?.EndPreview();
             DA.SetData(0, rigidOrigami.CMesh);
             DA.SetData(1, rigidOrigami);
             DA.SetData(2, residual);
@@ -175,6 +319,8 @@ namespace Crane.Components.Solver
             DA.GetData(7, ref isPanelFlat);
             DA.GetData(8, ref isFoldBlock);
             DA.GetData(9, ref isConstraint);
+            DA.GetData(10, ref progressInterval);
+            DA.GetData(11, ref trace);
         }
     }
 }
\ No newline at end of file
@@ -0,0 +1,247 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Threading;
+using System.Windows.Forms;
+using Crane.Core;
+using GrasshopperAsyncComponent;
+using Grasshopper.Kernel;
+using Grasshopper.Kernel.Data;
+using Grasshopper.Kernel.Types;
+
+namespace Crane.Components.Solver
+{
+    public class CraneBatchSolver : GH_AsyncComponent
+    {
+        /// <summary>
+        /// Initializes a new instance of the CraneBatchSolver class.
+        /// </summary>
+        public CraneBatchSolver()
+          : base("Crane Batch Solver", "Batch Solver",
+              "Solve many independent CMeshes (e.g. a parameter sweep) in parallel.",
+              "Crane", "Solver")
+        {
+            BaseWorker = new CraneBatchWorker(this);
+        }
+
+        /// <summary>
+        /// Registers all the input parameters for this component.
+        /// </summary>
+        protected override void RegisterInputParams(GH_Component.GH_InputParamManager pManager)
+        {
+            pManager.AddGenericParameter("CMeshes", "CMeshes", "Input CMeshes. Each CMesh is solved as an independent job.", GH_ParamAccess.list);
+            pManager.AddGenericParameter("Constraints", "Constraints",
+                "Input constraints. Branch i is used for the i-th CMesh. A single branch is used for all CMeshes.",
+                GH_ParamAccess.tree);
+            pManager.AddIntegerParameter("NR Iteration", "NR Iteration", "Each iteration of Newton Raphson method.", GH_ParamAccess.item, 50);
+            pManager.AddIntegerParameter("CGNR Iteration", "CGNR Iteration",
+                "Each iteration of CGNR method for solving linear equation in Newton Raphson method.",
+                GH_ParamAccess.item, 100);
+            pManager.AddNumberParameter("Threshold", "Threshold", "Threshold", GH_ParamAccess.item, 1e-13);
+            pManager.AddBooleanParameter("Solve", "Solve", "If true, run to solve constraints.", GH_ParamAccess.item,
+                false);
+            pManager.AddBooleanParameter("Is Rigid Edge", "Is Rigid Edge",
+                "if true, this enforce rigid edge constraint.", GH_ParamAccess.item, false);
+            pManager.AddBooleanParameter("Is Panel Flat", "Is Panel Flat",
+                "If true, this enforce panel flat constraint.", GH_ParamAccess.item, true);
+            pManager.AddBooleanParameter("Is Fold Block", "Is Fold Block",
+                "If true, this enforce 180° folding angle constarint", GH_ParamAccess.item, true);
+            pManager.AddBooleanParameter("Is Constraint", "Is Constraint",
+                "If true, this enforce additional constraints", GH_ParamAccess.item, true);
+            pManager.AddIntegerParameter("Threads", "Threads", "Number of worker threads. 0 uses all cores.", GH_ParamAccess.item, 0);
+            pManager.AddBooleanParameter("Trace", "Trace",
+                "If true, record each solver phase span for the Chrome trace export of the Solver Telemetry component.",
+                GH_ParamAccess.item, false);
+            pManager.AddBooleanParameter("Recycle", "Recycle",
+                "If true, consecutive CGNR solves of a job reuse the near-mechanism directions found by the previous ones (native solvers only). " +
+                "On Windows the jobs run one at a time without it, since the plain native solver cannot be limited to one thread per job.",
+                GH_ParamAccess.item, true);
+
+            pManager[1].Optional = true;
+            pManager[2].Optional = true;
+            pManager[3].Optional = true;
+            pManager[4].Optional = true;
+            pManager[5].Optional = true;
+            pManager[6].Optional = true;
+            pManager[7].Optional = true;
+            pManager[8].Optional = true;
+            pManager[9].Optional = true;
+            pManager[10].Optional = true;
+            pManager[11].Optional = true;
+            pManager[12].Optional = true;
+        }
+
+        /// <summary>
+        /// Registers all the output parameters for this component.
+        /// </summary>
+        protected override void RegisterOutputParams(GH_Component.GH_OutputParamManager pManager)
+        {
+            pManager.AddGenericParameter("CMesh", "CMesh", "Output the CMeshes", GH_ParamAccess.list);
+            pManager.AddGenericParameter("RigidOrigami", "RigidOrigami", "Output the RigidOrigamis", GH_ParamAccess.list);
+            pManager.AddNumberParameter("Residual", "Residual", "Residual of each job.", GH_ParamAccess.list);
+            pManager.AddBooleanParameter("Converged", "Converged", "True if the residual reached the threshold.", GH_ParamAccess.list);
+        }
+
+        /// <summary>
+        /// Provides an Icon for the component.
+        /// </summary>
+        protected override System.Drawing.Bitmap Icon
+        {
+            get
+            {
+                //You can add image files to your project resources and access them like this:
+                // return Resources.IconForThisComponent;
+                return Properties.Resource.icons_batch_solver;
+            }
+        }
+
+        /// <summary>
+        /// Gets the unique ID for this component. Do not change this ID after release.
+        /// </summary>
+        public override Guid ComponentGuid
+        {
+            get { return new Guid("8d3f6a2c-1b7e-4c59-a0e4-5f92c7b13d68"); }
+        }
+
+        public override void AppendAdditionalMenuItems(ToolStripDropDown menu)
+        {
+            base.AppendAdditionalMenuItems(menu);
+            Menu_AppendItem(menu, "Cancel", (s, e) =>
+            {
+                RequestCancellation();
+            });
+        }
+    }
+
+    public class CraneBatchWorker : WorkerInstance
+    {
+        List<CMesh> cMeshes = new List<CMesh>();
+        GH_Structure<IGH_Goo> constraintTree = new GH_Structure<IGH_Goo>();
+        int nrIteration = 50;
+        int cgnrIteration = 100;
+        double threshold = 1e-13;
+        bool solve = false;
+        bool isRigid = false;
+        bool isPanelFlat = true;
+        bool isFoldBlock = true;
+        bool isConstraint = true;
+        int threads = 0;
+        bool trace = false;
+        bool recycle = true;
+        bool limitsNativeThreads = true;
+        string inputError = null;
+        BatchSolveResult[] results = new BatchSolveResult[0];
+
+        public CraneBatchWorker(GH_Component parent) : base(parent) { }
+
+        public override WorkerInstance Duplicate()
+        {
+            return new CraneBatchWorker(Parent);
+        }
+
+        public override void DoWork(Action<string, double> ReportProgress, Action Done)
+        {
+            if (CancellationToken.IsCancellationRequested) return;
+
+            results = new BatchSolveResult[0];
+            int branches = constraintTree?.PathCount ?? 0;
+            inputError = branches > 1 && branches != cMeshes.Count
+                ? $"Constraints has {branches} branches for {cMeshes.Count} CMeshes. Give one branch per CMesh or a single branch for all."
+                : null;
+            if (inputError != null)
+            {
+                Done();
+                return;
+            }
+
+            var jobs = new List<BatchSolveJob>();
+            for (int i = 0; i < cMeshes.Count; i++)
+            {
+                jobs.Add(new BatchSolveJob(cMeshes[i], GetConstraints(i))
+                {
+                    NRIteration = nrIteration,
+                    CGNRIteration = cgnrIteration,
+                    Threshold = threshold,
+                    IsRigidMode = isRigid,
+                    IsPanelFlatMode = isPanelFlat,
+                    IsFoldBlockMode = isFoldBlock,
+                    IsConstraintMode = isConstraint,
+                    IsTracing = trace,
+                    IsRecycleMode = recycle,
+                });
+            }
+            results = new BatchSolveResult[jobs.Count];
+            if (!solve || jobs.Count == 0)
+            {
+                Done();
+                return;
+            }
+
+            limitsNativeThreads = BatchSolver.LimitsNativeThreads(jobs);
+            int finished = 0;
+            BatchSolver.Solve(jobs, result =>
+            {
+                results[result.Index] = result;
+                ReportProgress(Id, (double)Interlocked.Increment(ref finished) / jobs.Count);
+            }, threads, CancellationToken);
+
+            if (CancellationToken.IsCancellationRequested) return;
+            Done();
+        }
+
+        public override void SetData(IGH_DataAccess DA)
+        {
+            if (CancellationToken.IsCancellationRequested) return;
+            if (inputError != null)
+            {
+                Parent?.AddRuntimeMessage(GH_RuntimeMessageLevel.Error, inputError);
+                return;
+            }
+            if (!solve)
+            {
+                DA.SetDataList(0, cMeshes);
+                return;
+            }
+            DA.SetDataList(0, results.Select(r => r?.RigidOrigami?.CMesh));
+            DA.SetDataList(1, results.Select(r => r?.RigidOrigami));
+            DA.SetDataList(2, results.Select(r => r?.Residual ?? double.NaN));
+            DA.SetDataList(3, results.Select(r => r?.IsConverged ?? false));
+            foreach (var failed in results.Where(r => r?.Exception != null))
+                Parent?.AddRuntimeMessage(GH_RuntimeMessageLevel.Warning, $"Job {failed.Index} : {failed.Exception.Message}");
+            if (threads != 1 && !limitsNativeThreads)
+                Parent?.AddRuntimeMessage(GH_RuntimeMessageLevel.Remark,
+                    "The native solver on this platform cannot be limited to one thread per job, so the jobs ran one at a time on its own threads.");
+        }
+
+        public override void GetData(IGH_DataAccess DA, GH_ComponentParamServer Params)
+        {
+            if (CancellationToken.IsCancellationRequested) return;
+            DA.GetDataList(0, cMeshes);
+            DA.GetDataTree(1, out constraintTree);
+            DA.GetData(2, ref nrIteration);
+            DA.GetData(3, ref cgnrIteration);
+            DA.GetData(4, ref threshold);
+            DA.GetData(5, ref solve);
+            DA.GetData(6, ref isRigid);
+            DA.GetData(7, ref isPanelFlat);
+            DA.GetData(8, ref isFoldBlock);
+            DA.GetData(9, ref isConstraint);
+            DA.GetData(10, ref threads);
+            DA.GetData(11, ref trace);
+            DA.GetData(12, ref recycle);
+        }
+
+        /// <summary>
+        /// The branch count is checked in DoWork: it is 0, 1 or the number of CMeshes.
+        /// </summary>
+        private List<Constraint> GetConstraints(int jobIndex)
+        {
+            if (constraintTree == null || constraintTree.PathCount == 0) return new List<Constraint>();
+            int branch = constraintTree.PathCount == 1 ? 0 : jobIndex;
+            return constraintTree.Branches[branch]
+                .Select(goo => (goo as GH_ObjectWrapper)?.Value as Constraint)
+                .Where(c => c != null)
+                .ToList();
+        }
+    }
+}
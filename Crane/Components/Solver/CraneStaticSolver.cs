@@ -42,6 +42,12 @@ namespace Crane.Components.Solver
                 "If true, this enforce 180° folding angle constarint", GH_ParamAccess.item, true);
             pManager.AddBooleanParameter("Is Constraint", "Is Constraint",
                 "If true, this enforce additional constraints", GH_ParamAccess.item, true);
+            pManager.AddBooleanParameter("Trace", "Trace",
+                "If true, record each solver phase span for the Chrome trace export of the Solver Telemetry component.",
+                GH_ParamAccess.item, false);
+            pManager.AddBooleanParameter("Recycle", "Recycle",
+                "If true, consecutive CGNR solves reuse the near-mechanism directions found by the previous ones (native solvers only).",
+                GH_ParamAccess.item, true);
 
             pManager[1].Optional = true;
             pManager[2].Optional = true;
@@ -52,6 +58,8 @@ namespace Crane.Components.Solver
             pManager[7].Optional = true;
             pManager[8].Optional = true;
             pManager[9].Optional = true;
+            pManager[10].Optional = true;
+            pManager[11].Optional = true;
         }
 
         /// <summary>
@@ -86,6 +94,8 @@ namespace Crane.Components.Solver
             bool isPanelFlat = true;
             bool isFoldBlock = true;
             bool isConstraint = true;
+            bool trace = false;
+            bool recycle = true;
             double residual = 0;
 
             if(!DA.GetData(0, ref cMesh)) { return; }
@@ -98,8 +108,12 @@ namespace Crane.Components.Solver
             DA.GetData(7, ref isPanelFlat);
             DA.GetData(8, ref isFoldBlock);
             DA.GetData(9, ref isConstraint);
+            DA.GetData(10, ref trace);
+            DA.GetData(11, ref recycle);
 
             RigidOrigami rigidOrigami = new RigidOrigami(cMesh, constraints);
+            rigidOrigami.Telemetry.IsTracing = trace;
+            rigidOrigami.IsRecycleMode = recycle;
 
             rigidOrigami.SaveModes(isRigid, isPanelFlat, isFoldBlock, isConstraint);
 
@@ -0,0 +1,217 @@
+﻿using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Linq;
+using System.Threading;
+using System.Threading.Tasks;
+using MathNet.Numerics.LinearAlgebra;
+
+namespace Crane.Core
+{
+    /// <summary>
+    /// One independent model of a batch solve (e.g. one parameter set of a pattern sweep).
+    /// The defaults match the static solver.
+    /// </summary>
+    public class BatchSolveJob
+    {
+        public BatchSolveJob(CMesh cMesh, List<Constraint> constraints)
+        {
+            this.CMesh = cMesh;
+            this.Constraints = constraints ?? new List<Constraint>();
+        }
+        public CMesh CMesh { get; }
+        /// <summary>
+        /// Constraints of this job. Constraint objects shared between jobs are evaluated concurrently.
+        /// </summary>
+        public List<Constraint> Constraints { get; }
+        public int NRIteration { get; set; } = 50;
+        public int CGNRIteration { get; set; } = 100;
+        public double Threshold { get; set; } = 1e-13;
+        public bool IsRigidMode { get; set; } = false;
+        public bool IsPanelFlatMode { get; set; } = true;
+        public bool IsFoldBlockMode { get; set; } = true;
+        public bool IsConstraintMode { get; set; } = true;
+        /// <summary>
+        /// Shares a recycled Krylov subspace between the Newton steps of the job (see <see cref="RigidOrigami.IsRecycleMode"/>).
+        /// The recycled solves run in the worker's reusable workspace.
+        /// </summary>
+        public bool IsRecycleMode { get; set; } = true;
+        /// <summary>
+        /// Records the phase spans of the job for the Chrome trace export.
+        /// </summary>
+        public bool IsTracing { get; set; } = false;
+    }
+
+    public class BatchSolveResult
+    {
+        internal BatchSolveResult(int index, RigidOrigami rigidOrigami, double residual, bool isConverged,
+            double elapsedMilliseconds, Exception exception)
+        {
+            Index = index;
+            RigidOrigami = rigidOrigami;
+            Residual = residual;
+            IsConverged = isConverged;
+            ElapsedMilliseconds = elapsedMilliseconds;
+            Exception = exception;
+        }
+        /// <summary>
+        /// Index of the job in the input list.
+        /// </summary>
+        public int Index { get; }
+        public RigidOrigami RigidOrigami { get; }
+        public double Residual { get; }
+        public bool IsConverged { get; }
+        public double ElapsedMilliseconds { get; }
+        /// <summary>
+        /// Non-null when the job failed. A failed job does not stop the other jobs.
+        /// </summary>
+        public Exception Exception { get; }
+    }
+
+    /// <summary>
+    /// Solves many independent rigid origami models in parallel.
+    /// Jobs are load-balanced dynamically over the thread pool (work stealing), every worker
+    /// keeps one reusable native solver workspace, and BLAS runs single-threaded inside each job
+    /// so that the parallelism comes from the jobs only (see <see cref="LimitsNativeThreads"/>).
+    /// </summary>
+    public static class BatchSolver
+    {
+        /// <summary>
+        /// False when the native solves of <paramref name="jobs"/> cannot be limited to one BLAS thread per job,
+        /// e.g. on Windows for jobs without recycling (the plain solvers of cgnr.dll use MKL's default threading)
+        /// or with native libraries built before the per-thread limit was added.
+        /// <see cref="Solve"/> then runs the jobs one at a time so that they do not oversubscribe the cores.
+        /// Only looks the native exports up and changes no setting.
+        /// </summary>
+        public static bool LimitsNativeThreads(IEnumerable<BatchSolveJob> jobs)
+        {
+            if (jobs == null) throw new ArgumentNullException(nameof(jobs));
+            return jobs.All(job => SolverWorkspace.CanLimitBlasThreads(job.IsRecycleMode));
+        }
+
+        /// <summary>
+        /// Runs all jobs and calls <paramref name="onResult"/> as each job finishes (in completion order,
+        /// possibly from several threads at once). Returns normally when cancelled; the jobs that
+        /// had finished by then have been reported.
+        /// </summary>
+        /// <param name="maxDegreeOfParallelism">Number of workers. 0 or less uses all cores.
+        /// Ignored (one worker) when <see cref="LimitsNativeThreads"/> is false.</param>
+        public static void Solve(IList<BatchSolveJob> jobs, Action<BatchSolveResult> onResult,
+            int maxDegreeOfParallelism = 0, CancellationToken cancellationToken = default)
+        {
+            if (jobs == null) throw new ArgumentNullException(nameof(jobs));
+            if (onResult == null) throw new ArgumentNullException(nameof(onResult));
+
+            if (!LimitsNativeThreads(jobs)) maxDegreeOfParallelism = 1;
+            var options = new ParallelOptions
+            {
+                MaxDegreeOfParallelism = maxDegreeOfParallelism > 0 ? maxDegreeOfParallelism : Environment.ProcessorCount,
+                CancellationToken = cancellationToken,
+            };
+            // 1 件ずつ取り出す動的分割。 重さの違うジョブでも空いたワーカーが次を取る
+            var partitioner = Partitioner.Create(0, jobs.Count, 1);
+
+            try
+            {
+                Parallel.ForEach(partitioner, options,
+                    () =>
+                    {
+                        SolverWorkspace.SetBlasThreadsLocal(1);
+                        return new SolverWorkspace();
+                    },
+                    (range, state, workspace) =>
+                    {
+                        for (int i = range.Item1; i < range.Item2; i++)
+                        {
+                            if (state.ShouldExitCurrentIteration) break;
+                            var result = SolveJob(i, jobs[i], workspace, cancellationToken);
+                            if (result == null) break;
+                            onResult(result);
+                        }
+                        return workspace;
+                    },
+                    workspace =>
+                    {
+                        workspace.Dispose();
+                        SolverWorkspace.SetBlasThreadsLocal(0);
+                    });
+            }
+            catch (OperationCanceledException) when (cancellationToken.IsCancellationRequested)
+            {
+            }
+        }
+
+        /// <summary>
+        /// Runs all jobs in the background and yields the results as they finish.
+        /// </summary>
+        public static IEnumerable<BatchSolveResult> SolveStreaming(IList<BatchSolveJob> jobs,
+            int maxDegreeOfParallelism = 0, CancellationToken cancellationToken = default)
+        {
+            using var results = new BlockingCollection<BatchSolveResult>();
+            var task = Task.Run(() =>
+            {
+                try
+                {
+                    Solve(jobs, results.Add, maxDegreeOfParallelism, cancellationToken);
+                }
+                finally
+                {
+                    results.CompleteAdding();
+                }
+            });
+            foreach (var result in results.GetConsumingEnumerable())
+                yield return result;
+            task.GetAwaiter().GetResult();
+        }
+
+        /// <summary>
+        /// Returns null when the job was cancelled.
+        /// </summary>
+        private static BatchSolveResult SolveJob(int index, BatchSolveJob job, SolverWorkspace workspace,
+            CancellationToken cancellationToken)
+        {
+            long start = Stopwatch.GetTimestamp();
+            RigidOrigami rigidOrigami = null;
+            // Krylov 反復の中でもバッチのキャンセルを見る
+            using var monitor = new SolverMonitor(cancellationToken, null, 0);
+            try
+            {
+                rigidOrigami = new RigidOrigami(job.CMesh, job.Constraints);
+                rigidOrigami.Telemetry.IsTracing = job.IsTracing;
+                rigidOrigami.SaveModes(job.IsRigidMode, job.IsPanelFlatMode, job.IsFoldBlockMode, job.IsConstraintMode);
+                rigidOrigami.IsRecycleMode = job.IsRecycleMode;
+
+                workspace.Reset();
+                rigidOrigami.Workspace = workspace;
+                rigidOrigami.Monitor = monitor;
+                var moveVector = Vector<double>.Build.Dense(rigidOrigami.CMesh.DOF);
+                double residual = rigidOrigami.NRSolve(moveVector, job.Threshold, job.NRIteration, job.CGNRIteration);
+                return new BatchSolveResult(index, rigidOrigami, residual, residual <= job.Threshold,
+                    ElapsedMilliseconds(start), null);
+            }
+            catch (OperationCanceledException) when (cancellationToken.IsCancellationRequested)
+            {
+                return null;
+            }
+            catch (Exception e)
+            {
+                return new BatchSolveResult(index, rigidOrigami, double.NaN, false, ElapsedMilliseconds(start), e);
+            }
+            finally
+            {
+                // ワークスペースと監視はワーカー専用。 結果には持たせない
+                if (rigidOrigami != null)
+                {
+                    rigidOrigami.Workspace = null;
+                    rigidOrigami.Monitor = null;
+                }
+            }
+        }
+
+        private static double ElapsedMilliseconds(long start)
+        {
+            return (Stopwatch.GetTimestamp() - start) * 1000.0 / Stopwatch.Frequency;
+        }
+    }
+}
@@ -0,0 +1,96 @@
+﻿using System;
+using System.Threading;
+using MathNet.Numerics.LinearAlgebra;
+
+namespace Crane.Core
+{
+    /// <summary>
+    /// Lock-free buffered mesh vertex coordinates shared between a background solver and the UI.
+    /// The solver fills a spare slot and swaps it in as the latest one with <see cref="Interlocked.Exchange{T}(ref T, T)"/>;
+    /// the UI takes the latest slot out while copying it, so neither side ever waits for the other.
+    /// Each solve takes a new generation number and slots published by an older generation
+    /// (a stale solve still finishing its iteration) are dropped.
+    /// </summary>
+    public sealed class CoordinateDoubleBuffer
+    {
+        private sealed class Slot
+        {
+            public double[] Data = Array.Empty<double>();
+            public int Version;
+            public int Generation;
+        }
+
+        // 最新の値と、 書き込み側が次に使う予備。 読み出し中のスロットはどちらにも入っていない
+        private Slot latest;
+        private Slot spare;
+        private int version;
+        private int generation;
+
+        /// <summary>
+        /// Incremented by every accepted publish.
+        /// </summary>
+        public int Version => Volatile.Read(ref version);
+        public int Generation => Volatile.Read(ref generation);
+
+        /// <summary>
+        /// Starts a new solve. Publishes with an older generation are ignored from now on.
+        /// </summary>
+        public int NextGeneration()
+        {
+            return Interlocked.Increment(ref generation);
+        }
+
+        /// <summary>
+        /// Called by the solver. Returns false when <paramref name="solveGeneration"/> is stale.
+        /// </summary>
+        public bool Publish(Vector<double> coordinates, int solveGeneration)
+        {
+            if (solveGeneration != Generation) return false;
+
+            // 予備が読み出し側や別の書き込みに取られていれば新しく作る
+            var slot = Interlocked.Exchange(ref spare, null) ?? new Slot();
+            int n = coordinates.Count;
+            if (slot.Data.Length != n) slot.Data = new double[n];
+            var source = coordinates.AsArray();
+            if (source != null) Array.Copy(source, slot.Data, n);
+            else coordinates.CopyTo(Vector<double>.Build.DenseOfArray(slot.Data));
+            slot.Generation = solveGeneration;
+            slot.Version = Interlocked.Increment(ref version);
+
+            Recycle(Interlocked.Exchange(ref latest, slot));
+            return true;
+        }
+
+        /// <summary>
+        /// Called by the UI. Copies the latest coordinates into <paramref name="destination"/> (reallocated if the size differs)
+        /// when they are newer than <paramref name="seenVersion"/> and belong to the current generation.
+        /// </summary>
+        public bool TryRead(ref int seenVersion, ref double[] destination)
+        {
+            var slot = Interlocked.Exchange(ref latest, null);
+            if (slot == null) return false;
+            if (slot.Generation != Generation)
+            {
+                Recycle(slot);
+                return false;
+            }
+
+            bool isNew = slot.Version != seenVersion && slot.Data.Length > 0;
+            if (isNew)
+            {
+                if (destination == null || destination.Length != slot.Data.Length) destination = new double[slot.Data.Length];
+                Array.Copy(slot.Data, destination, slot.Data.Length);
+                seenVersion = slot.Version;
+            }
+
+            // 読んでいる間に新しい値が来ていなければ最新として戻す
+            if (Interlocked.CompareExchange(ref latest, slot, null) != null) Recycle(slot);
+            return isNew;
+        }
+
+        private void Recycle(Slot slot)
+        {
+            if (slot != null) Interlocked.CompareExchange(ref spare, slot, null);
+        }
+    }
+}
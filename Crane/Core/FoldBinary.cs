@@ -0,0 +1,213 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Runtime.InteropServices;
+using System.Text;
+using MathNet.Numerics.LinearAlgebra;
+
+namespace Crane.Core
+{
+    /// <summary>
+    /// Compact binary sidecar of a FOLD file ("model.fold.bin" next to "model.fold").
+    /// The flat buffers of the key frame and the vertex coordinates of every frame are stored as raw
+    /// little-endian arrays, so large models load with a few block reads instead of JSON parsing.
+    /// The JSON file stays the interchange format. The header stores the length and last write time of the
+    /// JSON file the sidecar was written for, and the sidecar is only used while both still match.
+    /// </summary>
+    public static class FoldBinary
+    {
+        private const int Magic = 0x42465243; // "CRFB"
+        private const int Version = 2;
+        // magic, version, JSON length, JSON write time, content, 5 counts
+        private const int HeaderSize = 4 + 4 + 8 + 8 + 4 + 5 * 4;
+
+        [Flags]
+        private enum Content
+        {
+            None = 0,
+            Vertices = 1,
+            Edges = 2,
+            Assignment = 4,
+            FoldAngle = 8,
+            Faces = 16,
+        }
+
+        public static string SidecarPath(string foldPath)
+        {
+            return foldPath + ".bin";
+        }
+
+        /// <summary>
+        /// Writes the sidecar of <paramref name="foldPath"/>. Write the FOLD file first; the sidecar is bound to it.
+        /// </summary>
+        public static void Write(string foldPath, FoldFrame keyFrame, IEnumerable<Vector<double>> frameCoordinates = null)
+        {
+            if (!BitConverter.IsLittleEndian) throw new PlatformNotSupportedException("The binary sidecar requires a little-endian platform.");
+
+            var json = new FileInfo(foldPath);
+            if (!json.Exists) throw new FileNotFoundException("Write the FOLD file before its binary sidecar.", foldPath);
+
+            // 途中まで書いた sidecar が残らないように、 開く前にすべてのフレームを確かめる
+            int length = 3 * keyFrame.VertexCount;
+            if (frameCoordinates != null)
+            {
+                frameCoordinates = frameCoordinates as ICollection<Vector<double>> ?? frameCoordinates.ToList();
+                if (frameCoordinates.Any(coords => coords.Count != length))
+                    throw new ArgumentException("The number of vertices differs from the key frame.", nameof(frameCoordinates));
+            }
+
+            using var stream = File.Create(SidecarPath(foldPath));
+            using var writer = new BinaryWriter(stream, Encoding.UTF8);
+
+            var content = Content.None;
+            if (keyFrame.VerticesCoords != null) content |= Content.Vertices;
+            if (keyFrame.EdgesVertices != null) content |= Content.Edges;
+            if (keyFrame.EdgesAssignment != null) content |= Content.Assignment;
+            if (keyFrame.EdgesFoldAngle != null) content |= Content.FoldAngle;
+            if (keyFrame.FacesOffsets != null) content |= Content.Faces;
+
+            writer.Write(Magic);
+            writer.Write(Version);
+            writer.Write(json.Length);
+            writer.Write(json.LastWriteTimeUtc.Ticks);
+            writer.Write((int)content);
+            writer.Write(keyFrame.VertexCount);
+            writer.Write(keyFrame.EdgeCount);
+            writer.Write(keyFrame.FaceCount);
+            writer.Write(keyFrame.FacesVertices?.Length ?? 0);
+            long frameCountPosition = stream.Position;
+            writer.Write(0);
+            WriteString(writer, keyFrame.FrameUnit);
+            WriteString(writer, keyFrame.FrameTitle);
+
+            WriteArray<double>(writer, keyFrame.VerticesCoords);
+            WriteArray<int>(writer, keyFrame.EdgesVertices);
+            if (keyFrame.EdgesAssignment != null)
+            {
+                var assignment = new byte[keyFrame.EdgesAssignment.Length];
+                for (int i = 0; i < assignment.Length; i++) assignment[i] = (byte)keyFrame.EdgesAssignment[i];
+                writer.Write(assignment);
+            }
+            WriteArray<double>(writer, keyFrame.EdgesFoldAngle);
+            WriteArray<int>(writer, keyFrame.FacesOffsets);
+            WriteArray<int>(writer, keyFrame.FacesVertices);
+
+            int frameCount = 0;
+            if (frameCoordinates != null)
+            {
+                foreach (var coords in frameCoordinates)
+                {
+                    WriteArray<double>(writer, coords.AsArray() ?? coords.ToArray());
+                    frameCount++;
+                }
+            }
+
+            // フレーム数は最後に書き戻す
+            writer.Flush();
+            stream.Position = frameCountPosition;
+            writer.Write(frameCount);
+        }
+
+        /// <summary>
+        /// Reads the sidecar of <paramref name="foldPath"/> if it exists and was written for the current FOLD file.
+        /// The frame coordinates are added to <paramref name="frameCoordinates"/> when it is not null.
+        /// Returns false for a missing, stale, truncated or otherwise invalid sidecar so the caller falls back to the JSON file.
+        /// </summary>
+        public static bool TryRead(string foldPath, out FoldFrame keyFrame, List<Vector<double>> frameCoordinates = null)
+        {
+            keyFrame = null;
+            string sidecar = SidecarPath(foldPath);
+            var json = new FileInfo(foldPath);
+            if (!BitConverter.IsLittleEndian || !json.Exists || !File.Exists(sidecar)) return false;
+
+            int added = 0;
+            try
+            {
+                using var stream = File.OpenRead(sidecar);
+                using var reader = new BinaryReader(stream, Encoding.UTF8);
+                if (stream.Length < HeaderSize || reader.ReadInt32() != Magic || reader.ReadInt32() != Version) return false;
+                if (reader.ReadInt64() != json.Length || reader.ReadInt64() != json.LastWriteTimeUtc.Ticks) return false;
+
+                var content = (Content)reader.ReadInt32();
+                int vertexCount = reader.ReadInt32();
+                int edgeCount = reader.ReadInt32();
+                int faceCount = reader.ReadInt32();
+                int faceVertexCount = reader.ReadInt32();
+                int frameCount = reader.ReadInt32();
+                if (vertexCount < 0 || edgeCount < 0 || faceCount < 0 || faceVertexCount < 0 || frameCount < 0) return false;
+
+                var frame = new FoldFrame
+                {
+                    FrameClasses = new string[] { "foldedForm" },
+                    FrameUnit = ReadString(reader),
+                    FrameTitle = ReadString(reader),
+                };
+
+                // 配列を確保する前に、 ヘッダーの数とファイルの残りの長さが合っているか確かめる
+                long size = 0;
+                if (content.HasFlag(Content.Vertices)) size += 3L * vertexCount * sizeof(double);
+                if (content.HasFlag(Content.Edges)) size += 2L * edgeCount * sizeof(int);
+                if (content.HasFlag(Content.Assignment)) size += edgeCount;
+                if (content.HasFlag(Content.FoldAngle)) size += (long)edgeCount * sizeof(double);
+                if (content.HasFlag(Content.Faces)) size += ((long)faceCount + 1 + faceVertexCount) * sizeof(int);
+                size += 3L * vertexCount * frameCount * sizeof(double);
+                if (size != stream.Length - stream.Position) return false;
+
+                if (content.HasFlag(Content.Vertices)) frame.VerticesCoords = ReadArray<double>(stream, 3 * vertexCount);
+                if (content.HasFlag(Content.Edges)) frame.EdgesVertices = ReadArray<int>(stream, 2 * edgeCount);
+                if (content.HasFlag(Content.Assignment))
+                {
+                    var assignment = ReadArray<byte>(stream, edgeCount);
+                    frame.EdgesAssignment = new char[edgeCount];
+                    for (int i = 0; i < edgeCount; i++) frame.EdgesAssignment[i] = (char)assignment[i];
+                }
+                if (content.HasFlag(Content.FoldAngle)) frame.EdgesFoldAngle = ReadArray<double>(stream, edgeCount);
+                if (content.HasFlag(Content.Faces))
+                {
+                    frame.FacesOffsets = ReadArray<int>(stream, faceCount + 1);
+                    frame.FacesVertices = ReadArray<int>(stream, faceVertexCount);
+                }
+
+                if (frameCoordinates != null)
+                {
+                    for (int i = 0; i < frameCount; i++, added++)
+                        frameCoordinates.Add(Vector<double>.Build.DenseOfArray(ReadArray<double>(stream, 3 * vertexCount)));
+                }
+
+                keyFrame = frame;
+                return true;
+            }
+            catch (Exception e) when (e is EndOfStreamException || e is IOException || e is UnauthorizedAccessException)
+            {
+                // JSON からの読み込みに戻るので、 途中まで追加したフレームは取り消す
+                frameCoordinates?.RemoveRange(frameCoordinates.Count - added, added);
+                return false;
+            }
+        }
+
+        private static void WriteArray<T>(BinaryWriter writer, T[] values) where T : struct
+        {
+            if (values == null) return;
+            writer.Write(MemoryMarshal.AsBytes(values.AsSpan()));
+        }
+
+        private static T[] ReadArray<T>(Stream stream, int length) where T : struct
+        {
+            var values = new T[length];
+            stream.ReadExactly(MemoryMarshal.AsBytes(values.AsSpan()));
+            return values;
+        }
+
+        private static void WriteString(BinaryWriter writer, string value)
+        {
+            writer.Write(value != null);
+            if (value != null) writer.Write(value);
+        }
+
+        private static string ReadString(BinaryReader reader)
+        {
+            return reader.ReadBoolean() ? reader.ReadString() : null;
+        }
+    }
+}
@@ -39,91 +39,59 @@ namespace Crane.Core
         public int[][] FacesVertices { get; set; }
 
         public FoldFormat() { }
-        public FoldFormat(CMesh cMesh, bool mVFullFold)
+        public FoldFormat(CMesh cMesh, bool mVFullFold) : this(cMesh, mVFullFold, ActiveDocumentUnit()) { }
+        /// <param name="frameUnit">FOLD unit string such as "m" or "mm". Does not touch the Rhino document.</param>
+        public FoldFormat(CMesh cMesh, bool mVFullFold, string frameUnit)
+            : this(FoldFrame.FromCMesh(cMesh, mVFullFold, frameUnit)) { }
+        /// <summary>
+        /// Single-model FOLD document of a frame. The flat buffers are copied into jagged arrays.
+        /// </summary>
+        public FoldFormat(FoldFrame frame)
         {
             FileClasses = new string[] { "singleModel" };
             FileCreator = "Crane";
             FileSpec = 1.1;
-            FrameClasses = new string[] { "foldedForm" };
-            FrameUnit = ParseRhinoModelUnitSystem(RhinoDoc.ActiveDoc.ModelUnitSystem);
-            VerticesCoords = new double[cMesh.Mesh.Vertices.Count][];
-            for (int i = 0; i < cMesh.Mesh.Vertices.Count; i++)
-            {
-                var pt = cMesh.Mesh.Vertices.Point3dAt(i);
-                double[] coord = new double[3];
-                for (int j = 0; j < 3; j++)
-                {
-                    coord[j] = pt[j];
-                }
-
-                VerticesCoords[i] = coord;
-            }
+            FrameClasses = frame.FrameClasses;
+            FrameUnit = frame.FrameUnit;
+            FrameTitle = frame.FrameTitle;
 
-            EdgesVertices = new int[cMesh.Mesh.TopologyEdges.Count][];
-            for (int i = 0; i < cMesh.Mesh.TopologyEdges.Count; i++)
+            VerticesCoords = new double[frame.VertexCount][];
+            for (int i = 0; i < frame.VertexCount; i++)
             {
-                var e = cMesh.Mesh.TopologyEdges.GetTopologyVertices(i);
-                EdgesVertices[i] = new int[] { e.I, e.J };
+                VerticesCoords[i] = new double[] { frame.VerticesCoords[3 * i], frame.VerticesCoords[3 * i + 1], frame.VerticesCoords[3 * i + 2] };
             }
 
-            EdgesAssignment = new string[cMesh.EdgeInfo.Count];
-            for (int i = 0; i < cMesh.EdgeInfo.Count; i++)
+            EdgesVertices = new int[frame.EdgeCount][];
+            for (int i = 0; i < frame.EdgeCount; i++)
             {
-                if (cMesh.EdgeInfo[i] == 'T')
-                {
-                    EdgesAssignment[i] = "F";
-                }
-                else
-                {
-                    EdgesAssignment[i] = cMesh.EdgeInfo[i].ToString();
-                }
+                EdgesVertices[i] = new int[] { frame.EdgesVertices[2 * i], frame.EdgesVertices[2 * i + 1] };
             }
 
-            EdgesFoldAngle = new double?[cMesh.EdgeInfo.Count];
-            var foldAngles = cMesh.GetFoldAngles();
-            int id = 0;
-            for (int i = 0; i < cMesh.EdgeInfo.Count; i++)
+            if (frame.EdgesAssignment != null)
             {
-                if (cMesh.EdgeInfo[i] != 'B')
+                EdgesAssignment = new string[frame.EdgesAssignment.Length];
+                for (int i = 0; i < EdgesAssignment.Length; i++)
                 {
-                    EdgesFoldAngle[i] = 180 * foldAngles[id] / Math.PI;
-                    id++;
-                }
-                else
-                {
-                    EdgesFoldAngle[i] = null;
+                    EdgesAssignment[i] = frame.EdgesAssignment[i].ToString();
                 }
             }
 
-            if (mVFullFold)
+            if (frame.EdgesFoldAngle != null)
             {
-                for (int i = 0; i < cMesh.EdgeInfo.Count; i++)
+                EdgesFoldAngle = new double?[frame.EdgesFoldAngle.Length];
+                for (int i = 0; i < EdgesFoldAngle.Length; i++)
                 {
-                    if (cMesh.EdgeInfo[i] == 'M')
-                    {
-                        EdgesFoldAngle[i] = -180;
-                    }
-                    else if (cMesh.EdgeInfo[i] == 'V')
-                    {
-                        EdgesFoldAngle[i] = 180;
-                    }
+                    double angle = frame.EdgesFoldAngle[i];
+                    EdgesFoldAngle[i] = double.IsNaN(angle) ? null : angle;
                 }
             }
 
-            FacesVertices = new int[cMesh.Mesh.Faces.Count][];
-            for (int i = 0; i < cMesh.Mesh.Faces.Count; i++)
+            FacesVertices = new int[frame.FaceCount][];
+            for (int i = 0; i < frame.FaceCount; i++)
             {
-                var face = cMesh.Mesh.Faces[i];
-                if (face.IsTriangle)
-                {
-                    FacesVertices[i] = new int[] { face.A, face.B, face.C };
-                }
-                else if (face.IsQuad)
-                {
-                    FacesVertices[i] = new int[] { face.A, face.B, face.C, face.D };
-                }
+                int s = frame.FacesOffsets[i];
+                FacesVertices[i] = frame.FacesVertices[s..frame.FacesOffsets[i + 1]];
             }
-
         }
         public CMesh ToCMesh()
         {
@@ -175,7 +143,15 @@ namespace Crane.Core
             FoldFormat foldFormat = JsonSerializer.Deserialize<FoldFormat>(jsonString);
             return foldFormat;
         }
-        private string ParseRhinoModelUnitSystem(Rhino.UnitSystem unitSystem)
+        /// <summary>
+        /// Unit of the active Rhino document, or "m" when there is no document (e.g. headless use).
+        /// </summary>
+        public static string ActiveDocumentUnit()
+        {
+            var doc = RhinoDoc.ActiveDoc;
+            return doc == null ? "m" : ParseRhinoModelUnitSystem(doc.ModelUnitSystem);
+        }
+        public static string ParseRhinoModelUnitSystem(Rhino.UnitSystem unitSystem)
         {
             string unit = "m";
             if (unitSystem == UnitSystem.Meters) unit = "m";
@@ -0,0 +1,203 @@
+﻿using System;
+using System.Collections.Generic;
+using MathNet.Numerics.LinearAlgebra;
+using Rhino.Geometry;
+
+namespace Crane.Core
+{
+    /// <summary>
+    /// One FOLD frame stored in flat buffers.
+    /// Arrays that are absent in the file are null (and are taken from the parent frame when the frame inherits).
+    /// </summary>
+    public class FoldFrame
+    {
+        public string[] FrameClasses { get; set; }
+        public string FrameTitle { get; set; }
+        public string FrameUnit { get; set; }
+        public int FrameParent { get; set; } = -1;
+        public bool FrameInherit { get; set; }
+        /// <summary>
+        /// x0, y0, z0, x1, y1, z1, ... 2D coordinates are stored with z = 0.
+        /// </summary>
+        public double[] VerticesCoords { get; set; }
+        /// <summary>
+        /// u0, v0, u1, v1, ...
+        /// </summary>
+        public int[] EdgesVertices { get; set; }
+        /// <summary>
+        /// One of 'M', 'V', 'F', 'B', 'U' per edge.
+        /// </summary>
+        public char[] EdgesAssignment { get; set; }
+        /// <summary>
+        /// Fold angle per edge in degrees. NaN stands for null.
+        /// </summary>
+        public double[] EdgesFoldAngle { get; set; }
+        /// <summary>
+        /// Face i consists of FacesVertices[FacesOffsets[i] .. FacesOffsets[i + 1]).
+        /// </summary>
+        public int[] FacesOffsets { get; set; }
+        public int[] FacesVertices { get; set; }
+
+        public int VertexCount => VerticesCoords == null ? 0 : VerticesCoords.Length / 3;
+        public int EdgeCount => EdgesVertices == null ? 0 : EdgesVertices.Length / 2;
+        public int FaceCount => FacesOffsets == null ? 0 : FacesOffsets.Length - 1;
+
+        public FoldFrame() { }
+
+        /// <param name="frameUnit">FOLD unit string such as "m" or "mm". Null writes no unit.</param>
+        public static FoldFrame FromCMesh(CMesh cMesh, bool mVFullFold, string frameUnit = null)
+        {
+            var mesh = cMesh.Mesh;
+            var frame = new FoldFrame
+            {
+                FrameClasses = new string[] { "foldedForm" },
+                FrameUnit = frameUnit,
+            };
+
+            int nv = mesh.Vertices.Count;
+            var coords = new double[3 * nv];
+            for (int i = 0; i < nv; i++)
+            {
+                var pt = mesh.Vertices.Point3dAt(i);
+                coords[3 * i] = pt.X;
+                coords[3 * i + 1] = pt.Y;
+                coords[3 * i + 2] = pt.Z;
+            }
+            frame.VerticesCoords = coords;
+
+            int ne = mesh.TopologyEdges.Count;
+            var edges = new int[2 * ne];
+            for (int i = 0; i < ne; i++)
+            {
+                var e = mesh.TopologyEdges.GetTopologyVertices(i);
+                edges[2 * i] = e.I;
+                edges[2 * i + 1] = e.J;
+            }
+            frame.EdgesVertices = edges;
+
+            var assignment = new char[cMesh.EdgeInfo.Count];
+            var foldAngle = new double[cMesh.EdgeInfo.Count];
+            var foldAngles = cMesh.GetFoldAngles();
+            int id = 0;
+            for (int i = 0; i < cMesh.EdgeInfo.Count; i++)
+            {
+                char info = cMesh.EdgeInfo[i];
+                assignment[i] = info == 'T' ? 'F' : info;
+                if (info == 'B')
+                {
+                    foldAngle[i] = double.NaN;
+                    continue;
+                }
+                foldAngle[i] = 180 * foldAngles[id] / Math.PI;
+                id++;
+                if (mVFullFold && info == 'M') foldAngle[i] = -180;
+                if (mVFullFold && info == 'V') foldAngle[i] = 180;
+            }
+            frame.EdgesAssignment = assignment;
+            frame.EdgesFoldAngle = foldAngle;
+
+            int nf = mesh.Faces.Count;
+            var offsets = new int[nf + 1];
+            var faces = new List<int>(4 * nf);
+            for (int i = 0; i < nf; i++)
+            {
+                var face = mesh.Faces[i];
+                faces.Add(face.A);
+                faces.Add(face.B);
+                faces.Add(face.C);
+                if (face.IsQuad) faces.Add(face.D);
+                offsets[i + 1] = faces.Count;
+            }
+            frame.FacesOffsets = offsets;
+            frame.FacesVertices = faces.ToArray();
+
+            return frame;
+        }
+
+        /// <summary>
+        /// Frame that only carries new vertex coordinates (e.g. one of RigidOrigami.RecordedMeshPoints)
+        /// and inherits everything else from <paramref name="parent"/>.
+        /// </summary>
+        public static FoldFrame FromCoordinates(Vector<double> meshVerticesVector, int parent = 0)
+        {
+            return new FoldFrame
+            {
+                FrameClasses = new string[] { "foldedForm" },
+                FrameParent = parent,
+                FrameInherit = true,
+                VerticesCoords = meshVerticesVector.ToArray(),
+            };
+        }
+
+        /// <summary>
+        /// Fills the arrays missing in this frame from its parent. The arrays are shared, not copied.
+        /// </summary>
+        public void InheritFrom(FoldFrame parent)
+        {
+            if (parent == null) return;
+            FrameUnit ??= parent.FrameUnit;
+            VerticesCoords ??= parent.VerticesCoords;
+            EdgesVertices ??= parent.EdgesVertices;
+            EdgesAssignment ??= parent.EdgesAssignment;
+            EdgesFoldAngle ??= parent.EdgesFoldAngle;
+            if (FacesOffsets == null)
+            {
+                FacesOffsets = parent.FacesOffsets;
+                FacesVertices = parent.FacesVertices;
+            }
+        }
+
+        public Vector<double> ToMeshVerticesVector()
+        {
+            return Vector<double>.Build.DenseOfArray((double[])VerticesCoords.Clone());
+        }
+
+        public CMesh ToCMesh()
+        {
+            Mesh mesh = new Mesh();
+            mesh.Vertices.UseDoublePrecisionVertices = true;
+            var coords = VerticesCoords;
+            mesh.Vertices.Capacity = VertexCount;
+            for (int i = 0; i < VertexCount; i++)
+            {
+                mesh.Vertices.Add(coords[3 * i], coords[3 * i + 1], coords[3 * i + 2]);
+            }
+
+            mesh.Faces.Capacity = FaceCount;
+            for (int i = 0; i < FaceCount; i++)
+            {
+                int s = FacesOffsets[i];
+                int count = FacesOffsets[i + 1] - s;
+                if (count == 3)
+                    mesh.Faces.AddFace(FacesVertices[s], FacesVertices[s + 1], FacesVertices[s + 2]);
+                else if (count == 4)
+                    mesh.Faces.AddFace(FacesVertices[s], FacesVertices[s + 1], FacesVertices[s + 2], FacesVertices[s + 3]);
+                else
+                    throw new Exception("The number of indices is not 3 or 4.");
+            }
+
+            var mountain = new List<Line>();
+            var valley = new List<Line>();
+            var triangle = new List<Line>();
+            if (EdgesAssignment != null)
+            {
+                for (int i = 0; i < EdgesAssignment.Length; i++)
+                {
+                    List<Line> lines;
+                    switch (EdgesAssignment[i])
+                    {
+                        case 'M': lines = mountain; break;
+                        case 'V': lines = valley; break;
+                        case 'F': lines = triangle; break;
+                        default: continue;
+                    }
+                    lines.Add(new Line(mesh.Vertices[EdgesVertices[2 * i]], mesh.Vertices[EdgesVertices[2 * i + 1]]));
+                }
+            }
+
+            mesh.Normals.ComputeNormals();
+            mesh.FaceNormals.ComputeFaceNormals();
+            return new CMesh(mesh, mountain, valley, triangle);
+        }
+    }
+}
@@ -0,0 +1,401 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text.Json;
+using MathNet.Numerics.LinearAlgebra;
+
+namespace Crane.Core
+{
+    /// <summary>
+    /// Streaming FOLD reader. The file is tokenized from a fixed-size buffer and the arrays are parsed
+    /// directly into the flat buffers of <see cref="FoldFrame"/>, so no JSON document or jagged array
+    /// is built. Frames in "file_frames" are parsed and yielded one at a time (see <see cref="ReadFrames"/>).
+    /// </summary>
+    public sealed class FoldReader : IDisposable
+    {
+        private readonly Stream stream;
+        private readonly bool leaveOpen;
+        private byte[] buffer = new byte[1 << 16];
+        private int start;
+        private int end;
+        private bool isFinalBlock;
+        private bool isFirstBlock = true;
+        private JsonReaderState state;
+
+        // 現在のトークン
+        private JsonTokenType tokenType;
+        private double number;
+        private char character;
+        private string text;
+
+        public FoldReader(Stream stream, bool leaveOpen = false)
+        {
+            this.stream = stream;
+            this.leaveOpen = leaveOpen;
+        }
+
+        public FoldReader(string path) : this(File.OpenRead(path)) { }
+
+        public double FileSpec { get; private set; }
+        public string FileCreator { get; private set; }
+        public string[] FileClasses { get; private set; }
+
+        public void Dispose()
+        {
+            if (!leaveOpen) stream.Dispose();
+        }
+
+        /// <summary>
+        /// Reads the key frame and, if <paramref name="frameCoordinates"/> is given, the vertex coordinates of
+        /// every frame in file_frames (with inheritance resolved). An up-to-date binary sidecar
+        /// (see <see cref="FoldBinary"/>) is used instead of the JSON file when it exists.
+        /// </summary>
+        public static FoldFrame Read(string path, List<Vector<double>> frameCoordinates = null)
+        {
+            if (FoldBinary.TryRead(path, out var keyFrame, frameCoordinates)) return keyFrame;
+
+            using var reader = new FoldReader(path);
+            keyFrame = null;
+            foreach (var frame in reader.ReadFrames(frameCoordinates != null))
+            {
+                if (keyFrame == null)
+                {
+                    keyFrame = frame;
+                    continue;
+                }
+                frameCoordinates.Add(frame.ToMeshVerticesVector());
+            }
+            return keyFrame;
+        }
+
+        /// <summary>
+        /// Yields the key frame first and then each frame of file_frames in file order, each as soon as it is complete.
+        /// Inheriting frames have their missing arrays filled from their parent.
+        /// When the key frame arrays come before file_frames (as <see cref="FoldWriter"/> writes them), the key frame
+        /// is yielded when file_frames starts and every frame when its object is closed. A frame is held back only while
+        /// its parent is not complete: the key frame when its arrays follow file_frames (it is then complete when the
+        /// top-level object is closed), or a later frame named by frame_parent.
+        /// Key frame properties after file_frames are still read into the yielded key frame, but frames yielded
+        /// before them do not inherit them.
+        /// </summary>
+        /// <param name="includeFrames">If false, file_frames is skipped and only the key frame is yielded.</param>
+        public IEnumerable<FoldFrame> ReadFrames(bool includeFrames = true)
+        {
+            if (!Read() || tokenType != JsonTokenType.StartObject)
+                throw new InvalidDataException("FOLD file must be a JSON object.");
+
+            var keyFrame = new FoldFrame();
+            // 親として参照されうるのですべてのフレームを持つ。 resolved は継承を解決済みで親に使えるか
+            var frames = new List<FoldFrame> { keyFrame };
+            var resolved = new List<bool> { false };
+            // 先頭から返したフレーム数。 それより前はすべて解決済み
+            int yielded = 0;
+
+            while (Read() && tokenType == JsonTokenType.PropertyName)
+            {
+                switch (text)
+                {
+                    case "file_frames":
+                        if (!includeFrames)
+                        {
+                            Skip();
+                            break;
+                        }
+                        // キーフレームの配列が先に来ていれば、 ここで完成したものとして返す
+                        if (keyFrame.VerticesCoords != null)
+                        {
+                            resolved[0] = true;
+                            while (yielded < frames.Count && resolved[yielded]) yield return frames[yielded++];
+                        }
+                        Expect(JsonTokenType.StartArray);
+                        while (Read() && tokenType != JsonTokenType.EndArray)
+                        {
+                            if (tokenType != JsonTokenType.StartObject)
+                                throw new InvalidDataException("file_frames must be an array of objects.");
+                            var frame = new FoldFrame();
+                            while (Read() && tokenType == JsonTokenType.PropertyName)
+                                ReadFrameProperty(frame, text);
+                            frames.Add(frame);
+                            resolved.Add(false);
+                            // キーフレームが未完成なら何も返せないので、 閉じてからまとめて解決する
+                            if (!resolved[0]) continue;
+                            Resolve(frames, resolved, yielded, false);
+                            while (yielded < frames.Count && resolved[yielded]) yield return frames[yielded++];
+                        }
+                        break;
+                    case "file_spec":
+                        Read();
+                        FileSpec = number;
+                        break;
+                    case "file_creator":
+                        Read();
+                        FileCreator = text ?? character.ToString();
+                        break;
+                    case "file_classes":
+                        FileClasses = ReadStrings();
+                        break;
+                    default:
+                        ReadFrameProperty(keyFrame, text);
+                        break;
+                }
+            }
+            if (tokenType != JsonTokenType.EndObject)
+                throw new InvalidDataException("FOLD file ended before the top-level object was closed.");
+
+            resolved[0] = true;
+            Resolve(frames, resolved, Math.Max(1, yielded), true);
+            while (yielded < frames.Count) yield return frames[yielded++];
+        }
+
+        /// <summary>
+        /// Resolves the inheritance of the frames from <paramref name="from"/> on whose parent is resolved, until nothing changes.
+        /// At the end of the file (<paramref name="isFinal"/>) a frame still unresolved has an invalid or cyclic frame_parent.
+        /// </summary>
+        private static void Resolve(List<FoldFrame> frames, List<bool> resolved, int from, bool isFinal)
+        {
+            bool changed = true;
+            while (changed)
+            {
+                changed = false;
+                for (int i = from; i < frames.Count; i++)
+                {
+                    if (resolved[i]) continue;
+                    var frame = frames[i];
+                    if (frame.FrameInherit)
+                    {
+                        int parent = frame.FrameParent;
+                        if (parent < 0 || parent == i || (isFinal && parent >= frames.Count))
+                            throw new InvalidDataException($"Invalid frame_parent {parent}.");
+                        // 親がまだ読まれていないか未解決なら待つ
+                        if (parent >= frames.Count || !resolved[parent]) continue;
+                        frame.InheritFrom(frames[parent]);
+                    }
+                    resolved[i] = true;
+                    changed = true;
+                }
+            }
+            if (!isFinal) return;
+            for (int i = from; i < frames.Count; i++)
+            {
+                if (!resolved[i]) throw new InvalidDataException($"Invalid frame_parent {frames[i].FrameParent}.");
+            }
+        }
+
+        private void ReadFrameProperty(FoldFrame frame, string name)
+        {
+            switch (name)
+            {
+                case "frame_classes":
+                    frame.FrameClasses = ReadStrings();
+                    break;
+                case "frame_title":
+                    Read();
+                    frame.FrameTitle = tokenType == JsonTokenType.String ? text ?? character.ToString() : null;
+                    break;
+                case "frame_unit":
+                    Read();
+                    frame.FrameUnit = tokenType == JsonTokenType.String ? text ?? character.ToString() : null;
+                    break;
+                case "frame_parent":
+                    Read();
+                    frame.FrameParent = (int)number;
+                    break;
+                case "frame_inherit":
+                    Read();
+                    frame.FrameInherit = tokenType == JsonTokenType.True;
+                    break;
+                case "vertices_coords":
+                    frame.VerticesCoords = ReadCoordinates();
+                    break;
+                case "edges_vertices":
+                    frame.EdgesVertices = ReadEdges();
+                    break;
+                case "edges_assignment":
+                    frame.EdgesAssignment = ReadAssignment();
+                    break;
+                case "edges_foldAngle":
+                    frame.EdgesFoldAngle = ReadNullableNumbers();
+                    break;
+                case "faces_vertices":
+                    ReadFaces(frame);
+                    break;
+                default:
+                    Skip();
+                    break;
+            }
+        }
+
+        private double[] ReadCoordinates()
+        {
+            Expect(JsonTokenType.StartArray);
+            var coords = new List<double>();
+            while (Read() && tokenType == JsonTokenType.StartArray)
+            {
+                int dim = 0;
+                while (Read() && tokenType == JsonTokenType.Number)
+                {
+                    if (dim < 3) coords.Add(number);
+                    dim++;
+                }
+                for (; dim < 3; dim++) coords.Add(0);
+            }
+            return coords.ToArray();
+        }
+
+        private int[] ReadEdges()
+        {
+            Expect(JsonTokenType.StartArray);
+            var edges = new List<int>();
+            while (Read() && tokenType == JsonTokenType.StartArray)
+            {
+                int count = 0;
+                while (Read() && tokenType == JsonTokenType.Number)
+                {
+                    if (count < 2) edges.Add((int)number);
+                    count++;
+                }
+                if (count != 2) throw new InvalidDataException("edges_vertices must have two vertices per edge.");
+            }
+            return edges.ToArray();
+        }
+
+        private char[] ReadAssignment()
+        {
+            Expect(JsonTokenType.StartArray);
+            var assignment = new List<char>();
+            while (Read() && tokenType == JsonTokenType.String)
+            {
+                assignment.Add(text == null ? character : text.Length > 0 ? text[0] : 'U');
+            }
+            return assignment.ToArray();
+        }
+
+        private double[] ReadNullableNumbers()
+        {
+            Expect(JsonTokenType.StartArray);
+            var values = new List<double>();
+            while (Read() && tokenType != JsonTokenType.EndArray)
+            {
+                values.Add(tokenType == JsonTokenType.Number ? number : double.NaN);
+            }
+            return values.ToArray();
+        }
+
+        private void ReadFaces(FoldFrame frame)
+        {
+            Expect(JsonTokenType.StartArray);
+            var offsets = new List<int> { 0 };
+            var faces = new List<int>();
+            while (Read() && tokenType == JsonTokenType.StartArray)
+            {
+                while (Read() && tokenType == JsonTokenType.Number) faces.Add((int)number);
+                offsets.Add(faces.Count);
+            }
+            frame.FacesOffsets = offsets.ToArray();
+            frame.FacesVertices = faces.ToArray();
+        }
+
+        private string[] ReadStrings()
+        {
+            Read();
+            if (tokenType == JsonTokenType.String) return new string[] { text ?? character.ToString() };
+            if (tokenType != JsonTokenType.StartArray)
+            {
+                Skip(false);
+                return null;
+            }
+            var values = new List<string>();
+            while (Read() && tokenType == JsonTokenType.String) values.Add(text ?? character.ToString());
+            return values.ToArray();
+        }
+
+        private void Expect(JsonTokenType expected)
+        {
+            if (!Read() || tokenType != expected)
+                throw new InvalidDataException($"Expected {expected} but found {tokenType}.");
+        }
+
+        /// <summary>
+        /// Skips the value of the current property.
+        /// </summary>
+        /// <param name="readValue">False when the first token of the value is already read.</param>
+        private void Skip(bool readValue = true)
+        {
+            if (readValue) Read();
+            if (tokenType != JsonTokenType.StartArray && tokenType != JsonTokenType.StartObject) return;
+            int depth = 1;
+            while (depth > 0 && Read())
+            {
+                if (tokenType == JsonTokenType.StartArray || tokenType == JsonTokenType.StartObject) depth++;
+                else if (tokenType == JsonTokenType.EndArray || tokenType == JsonTokenType.EndObject) depth--;
+            }
+        }
+
+        /// <summary>
+        /// Reads the next token into tokenType / number / character / text.
+        /// One-character strings (edge assignments) are returned in character with text = null to avoid allocations.
+        /// </summary>
+        private bool Read()
+        {
+            while (true)
+            {
+                var reader = new Utf8JsonReader(new ReadOnlySpan<byte>(buffer, start, end - start), isFinalBlock, state);
+                if (reader.Read())
+                {
+                    tokenType = reader.TokenType;
+                    text = null;
+                    switch (tokenType)
+                    {
+                        case JsonTokenType.Number:
+                            number = reader.GetDouble();
+                            break;
+                        case JsonTokenType.String:
+                            if (reader.ValueSpan.Length == 1 && !reader.ValueIsEscaped)
+                                character = (char)reader.ValueSpan[0];
+                            else
+                                text = reader.GetString();
+                            break;
+                        case JsonTokenType.PropertyName:
+                            text = reader.GetString();
+                            break;
+                    }
+                    start += (int)reader.BytesConsumed;
+                    state = reader.CurrentState;
+                    return true;
+                }
+                if (isFinalBlock)
+                {
+                    tokenType = JsonTokenType.None;
+                    return false;
+                }
+                start += (int)reader.BytesConsumed;
+                state = reader.CurrentState;
+                Fill();
+            }
+        }
+
+        private void Fill()
+        {
+            int remaining = end - start;
+            if (remaining == buffer.Length)
+            {
+                // 1 トークンがバッファに収まらない
+                Array.Resize(ref buffer, buffer.Length * 2);
+            }
+            else if (start > 0)
+            {
+                Buffer.BlockCopy(buffer, start, buffer, 0, remaining);
+            }
+            start = 0;
+            end = remaining;
+
+            int read = stream.Read(buffer, end, buffer.Length - end);
+            if (read == 0) isFinalBlock = true;
+            end += read;
+
+            if (isFirstBlock && end >= 3 && buffer[0] == 0xEF && buffer[1] == 0xBB && buffer[2] == 0xBF)
+                start = 3;
+            if (end >= 3 || isFinalBlock) isFirstBlock = false;
+        }
+    }
+}
@@ -0,0 +1,196 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text.Json;
+using MathNet.Numerics.LinearAlgebra;
+
+namespace Crane.Core
+{
+    /// <summary>
+    /// Streaming FOLD writer. The key frame is written first and further frames are appended to
+    /// "file_frames" one by one and flushed, so a recorded trajectory can be exported while it grows.
+    /// Dispose closes the JSON document.
+    /// </summary>
+    public sealed class FoldWriter : IDisposable
+    {
+        private readonly Stream stream;
+        private readonly bool leaveOpen;
+        private readonly Utf8JsonWriter writer;
+        private bool hasKeyFrame;
+        private bool inFrames;
+        private bool isClosed;
+
+        public FoldWriter(Stream stream, bool leaveOpen = false, bool indented = false)
+        {
+            this.stream = stream;
+            this.leaveOpen = leaveOpen;
+            writer = new Utf8JsonWriter(stream, new JsonWriterOptions { Indented = indented, SkipValidation = true });
+        }
+
+        public FoldWriter(string path, bool indented = false) : this(File.Create(path), false, indented) { }
+
+        /// <summary>
+        /// Number of frames appended to "file_frames".
+        /// </summary>
+        public int FrameCount { get; private set; }
+
+        /// <param name="isAnimation">Sets file_classes to "animation" instead of "singleModel".</param>
+        public void WriteKeyFrame(FoldFrame frame, bool isAnimation = false)
+        {
+            if (hasKeyFrame) throw new InvalidOperationException("The key frame is already written.");
+            writer.WriteStartObject();
+            writer.WriteNumber("file_spec", 1.1);
+            writer.WriteString("file_creator", "Crane");
+            writer.WriteStartArray("file_classes");
+            writer.WriteStringValue(isAnimation ? "animation" : "singleModel");
+            writer.WriteEndArray();
+            WriteFrameProperties(frame);
+            hasKeyFrame = true;
+            writer.Flush();
+        }
+
+        public void AppendFrame(FoldFrame frame)
+        {
+            if (!hasKeyFrame) throw new InvalidOperationException("Write the key frame first.");
+            if (!inFrames)
+            {
+                writer.WriteStartArray("file_frames");
+                inFrames = true;
+            }
+            writer.WriteStartObject();
+            WriteFrameProperties(frame);
+            writer.WriteEndObject();
+            FrameCount++;
+            writer.Flush();
+        }
+
+        public void AppendFrame(Vector<double> meshVerticesVector)
+        {
+            AppendFrame(FoldFrame.FromCoordinates(meshVerticesVector));
+        }
+
+        public void Close()
+        {
+            if (isClosed) return;
+            isClosed = true;
+            if (hasKeyFrame)
+            {
+                if (inFrames) writer.WriteEndArray();
+                writer.WriteEndObject();
+            }
+            writer.Flush();
+        }
+
+        public void Dispose()
+        {
+            Close();
+            writer.Dispose();
+            if (!leaveOpen) stream.Dispose();
+        }
+
+        /// <summary>
+        /// Writes a single-frame FOLD file of the CMesh.
+        /// </summary>
+        public static void Write(string path, CMesh cMesh, bool mVFullFold, string frameUnit = null)
+        {
+            using var foldWriter = new FoldWriter(path, true);
+            foldWriter.WriteKeyFrame(FoldFrame.FromCMesh(cMesh, mVFullFold, frameUnit));
+        }
+
+        /// <summary>
+        /// Writes the CMesh as the key frame and every recorded mesh point vector of the rigid origami
+        /// as an inheriting frame in file_frames. Without records a single-frame file is written.
+        /// </summary>
+        public static void WriteRecords(string path, RigidOrigami rigidOrigami, bool mVFullFold, string frameUnit = null)
+        {
+            var records = rigidOrigami.RecordedMeshPoints;
+            bool hasRecords = records != null && records.Count > 0;
+            var keyFrame = FoldFrame.FromCMesh(rigidOrigami.CMesh, mVFullFold, frameUnit);
+            if (hasRecords && records.Exists(points => points.Count != 3 * keyFrame.VertexCount))
+                throw new ArgumentException("The number of vertices of a record differs from the CMesh.", nameof(rigidOrigami));
+            using var foldWriter = new FoldWriter(path);
+            foldWriter.WriteKeyFrame(keyFrame, hasRecords);
+            if (!hasRecords) return;
+            foreach (var points in records)
+                foldWriter.AppendFrame(points);
+        }
+
+        private void WriteFrameProperties(FoldFrame frame)
+        {
+            if (frame.FrameClasses != null)
+            {
+                writer.WriteStartArray("frame_classes");
+                foreach (var c in frame.FrameClasses) writer.WriteStringValue(c);
+                writer.WriteEndArray();
+            }
+            if (frame.FrameTitle != null) writer.WriteString("frame_title", frame.FrameTitle);
+            if (frame.FrameUnit != null) writer.WriteString("frame_unit", frame.FrameUnit);
+            if (frame.FrameParent >= 0)
+            {
+                writer.WriteNumber("frame_parent", frame.FrameParent);
+                writer.WriteBoolean("frame_inherit", frame.FrameInherit);
+            }
+            if (frame.VerticesCoords != null)
+                WriteTuples("vertices_coords", frame.VerticesCoords, 3);
+            if (frame.EdgesVertices != null)
+                WriteTuples("edges_vertices", frame.EdgesVertices, 2);
+            if (frame.EdgesAssignment != null)
+            {
+                writer.WriteStartArray("edges_assignment");
+                Span<char> c = stackalloc char[1];
+                foreach (var a in frame.EdgesAssignment)
+                {
+                    c[0] = a;
+                    writer.WriteStringValue(c);
+                }
+                writer.WriteEndArray();
+            }
+            if (frame.EdgesFoldAngle != null)
+            {
+                writer.WriteStartArray("edges_foldAngle");
+                foreach (var angle in frame.EdgesFoldAngle)
+                {
+                    if (double.IsNaN(angle)) writer.WriteNullValue();
+                    else writer.WriteNumberValue(angle);
+                }
+                writer.WriteEndArray();
+            }
+            if (frame.FacesOffsets != null)
+            {
+                writer.WriteStartArray("faces_vertices");
+                for (int i = 0; i < frame.FaceCount; i++)
+                {
+                    writer.WriteStartArray();
+                    for (int j = frame.FacesOffsets[i]; j < frame.FacesOffsets[i + 1]; j++)
+                        writer.WriteNumberValue(frame.FacesVertices[j]);
+                    writer.WriteEndArray();
+                }
+                writer.WriteEndArray();
+            }
+        }
+
+        private void WriteTuples(string name, double[] values, int size)
+        {
+            writer.WriteStartArray(name);
+            for (int i = 0; i < values.Length; i += size)
+            {
+                writer.WriteStartArray();
+                for (int j = 0; j < size; j++) writer.WriteNumberValue(values[i + j]);
+                writer.WriteEndArray();
+            }
+            writer.WriteEndArray();
+        }
+
+        private void WriteTuples(string name, int[] values, int size)
+        {
+            writer.WriteStartArray(name);
+            for (int i = 0; i < values.Length; i += size)
+            {
+                writer.WriteStartArray();
+                for (int j = 0; j < size; j++) writer.WriteNumberValue(values[i + j]);
+                writer.WriteEndArray();
+            }
+            writer.WriteEndArray();
+        }
+    }
+}
@@ -0,0 +1,140 @@
+﻿using System;
+using System.Runtime.InteropServices;
+
+namespace Crane.Core
+{
+    /// <summary>
+    /// Native workspace of the recycled (deflated) CG / CGNR solvers.
+    /// Keeps a small subspace of approximate near-singular vectors between consecutive solves
+    /// and deflates it from later ones. Do not share one instance between threads.
+    /// </summary>
+    internal sealed class KrylovRecycleSpace : SafeHandle
+    {
+        internal const int SubspaceSize = 8;
+        internal const int HarvestSize = 16;
+
+        private static bool isUnavailable = false;
+        private static bool isThreadStatsUnavailable = false;
+        private readonly bool isMkl;
+
+        private KrylovRecycleSpace(IntPtr handle, bool isMkl) : base(IntPtr.Zero, true)
+        {
+            SetHandle(handle);
+            this.isMkl = isMkl;
+        }
+
+        public override bool IsInvalid => handle == IntPtr.Zero;
+
+        internal static bool IsMkl =>
+            RuntimeInformation.IsOSPlatform(OSPlatform.Windows) && RuntimeInformation.ProcessArchitecture == Architecture.X64;
+        internal static bool IsArmpl =>
+            RuntimeInformation.IsOSPlatform(OSPlatform.OSX) && RuntimeInformation.ProcessArchitecture == Architecture.Arm64;
+
+        /// <summary>
+        /// Returns null when no native solver with recycling is available on this platform,
+        /// which includes native libraries built before the recycled entry points were added.
+        /// The callers then use the plain native solvers.
+        /// </summary>
+        internal static KrylovRecycleSpace Create(int subspaceSize = SubspaceSize, int harvestSize = HarvestSize)
+        {
+            if (isUnavailable) return null;
+            try
+            {
+                IntPtr h = IntPtr.Zero;
+                if (IsMkl) h = NativeMethods.RecycleCreateMkl(subspaceSize, harvestSize);
+                else if (IsArmpl) h = NativeMethods.RecycleCreate(subspaceSize, harvestSize);
+                if (h != IntPtr.Zero) return new KrylovRecycleSpace(h, IsMkl);
+            }
+            catch (DllNotFoundException) { }
+            catch (EntryPointNotFoundException) { }
+            isUnavailable = true;
+            return null;
+        }
+
+        internal void Reset()
+        {
+            if (isMkl) NativeMethods.RecycleResetMkl(this);
+            else NativeMethods.RecycleReset(this);
+        }
+
+        /// <summary>
+        /// Sets the progress callback and the cancellation flag (a native int) polled by the solves.
+        /// The callback must stay alive until it is removed again.
+        /// </summary>
+        internal void SetMonitor(NativeMethods.ProgressCallback progress, int every, IntPtr cancel)
+        {
+            try
+            {
+                if (isMkl) NativeMethods.RecycleSetMonitorMkl(this, progress, IntPtr.Zero, every, cancel);
+                else NativeMethods.RecycleSetMonitor(this, progress, IntPtr.Zero, every, cancel);
+            }
+            catch (EntryPointNotFoundException)
+            {
+                // 古いネイティブライブラリ。 求解の後でキャンセルを確認する
+            }
+        }
+
+        /// <summary>
+        /// Cumulative statistics of the solves that used this workspace.
+        /// </summary>
+        internal NativeSolverStats GetStats()
+        {
+            NativeSolverStats stats;
+            try
+            {
+                if (isMkl) NativeMethods.RecycleStatsMkl(this, out stats);
+                else NativeMethods.RecycleStats(this, out stats);
+            }
+            catch (EntryPointNotFoundException)
+            {
+                stats = default;
+            }
+            return stats;
+        }
+
+        /// <summary>
+        /// Cumulative statistics of all native solves run on the calling thread, including the plain solvers.
+        /// Returns null on platforms without a native solver and for native libraries built before the export was added.
+        /// </summary>
+        internal static NativeSolverStats? GetThreadStats()
+        {
+            if (isThreadStatsUnavailable || !(IsMkl || IsArmpl)) return null;
+            try
+            {
+                NativeSolverStats stats;
+                if (IsMkl) NativeMethods.ThreadStatsMkl(out stats);
+                else NativeMethods.ThreadStats(out stats);
+                return stats;
+            }
+            catch (DllNotFoundException) { }
+            catch (EntryPointNotFoundException) { }
+            isThreadStatsUnavailable = true;
+            return null;
+        }
+
+        protected override bool ReleaseHandle()
+        {
+            if (isMkl) NativeMethods.RecycleDestroyMkl(handle);
+            else NativeMethods.RecycleDestroy(handle);
+            return true;
+        }
+    }
+
+    /// <summary>
+    /// Mirror of cgnr_stats_t in the native solvers.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct NativeSolverStats
+    {
+        public long Solves;
+        public long Iterations;
+        public long SpMV;
+        public long Allocations;
+        public long SolveNanoseconds;
+        public long SetupNanoseconds;
+        public long IterateNanoseconds;
+        public long UpdateNanoseconds;
+        public int LastIterations;
+        public double LastResidual;
+    }
+}
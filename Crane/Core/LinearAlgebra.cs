@@ -123,18 +123,22 @@ namespace Crane.Core
             }
 
         }
-        internal static Vector<double> Solve(SparseMatrix A, Vector<double> b, Vector<double> x, double threshold, int iterationMax)
+        /// <param name="monitor">Cancellation and progress. Polled inside the Krylov loop by the managed and
+        /// the recycled native solvers; the plain native solvers are not interrupted, so callers that need the monitor
+        /// pass a <paramref name="recycleSpace"/>.</param>
+        internal static Vector<double> Solve(SparseMatrix A, Vector<double> b, Vector<double> x, double threshold, int iterationMax,
+            KrylovRecycleSpace recycleSpace = null, SolverTelemetry telemetry = null, SolverMonitor monitor = null)
         {
             var cpuArchitecture = RuntimeInformation.ProcessArchitecture;
             if (RuntimeInformation.IsOSPlatform(OSPlatform.Windows))
             {
                 if (cpuArchitecture == Architecture.X64)
                 {
-                    return SolveMKL(A, b, x, threshold, iterationMax);
+                    return SolveMKL(A, b, x, threshold, iterationMax, recycleSpace, telemetry, monitor);
                 }
                 else
                 {
-                    return SolveManaged(A, b, x, threshold, iterationMax);
+                    return SolveManaged(A, b, x, threshold, iterationMax, telemetry, monitor);
                 }
             }
             else if (RuntimeInformation.IsOSPlatform(OSPlatform.OSX))
@@ -142,19 +146,20 @@ namespace Crane.Core
                 if (cpuArchitecture == Architecture.Arm64)
                 {
 
-                    return SolveArmpl(A, b, x, threshold, iterationMax);
+                    return SolveArmpl(A, b, x, threshold, iterationMax, recycleSpace, telemetry, monitor);
                 }
                 else
                 {
-                    return SolveManaged(A, b, x, threshold, iterationMax);
+                    return SolveManaged(A, b, x, threshold, iterationMax, telemetry, monitor);
                 }
             }
             else
             {
-                return SolveManaged(A, b, x, threshold, iterationMax);
+                return SolveManaged(A, b, x, threshold, iterationMax, telemetry, monitor);
             }
         }
-        private static Vector<double> SolveManaged(SparseMatrix A, Vector<double> b, Vector<double> x, double threshold, int iterationMax)
+        private static Vector<double> SolveManaged(SparseMatrix A, Vector<double> b, Vector<double> x, double threshold, int iterationMax,
+            SolverTelemetry telemetry = null, SolverMonitor monitor = null)
         {
             int iteration = 0;
             Matrix<double> AT = A.Transpose();
@@ -162,6 +167,9 @@ namespace Crane.Core
             Vector<double> p = AT * r;
             double alpha, beta;
             int matSize = Math.Min(A.ColumnCount, A.RowCount);
+            // 進捗はネイティブ版と同じく ‖b − A x‖ / ‖b‖ で通知する
+            double bNorm = b.L2Norm();
+            if (bNorm == 0) bNorm = 1;
 
             while ((iteration < Math.Min(iterationMax, matSize + 1)) && r.L2Norm() > threshold)
             {
@@ -174,10 +182,13 @@ namespace Crane.Core
                 beta = Math.Pow(ATr1.L2Norm(), 2) / Math.Pow(ATr0.L2Norm(), 2);
                 p = ATr1 + beta * p;
                 iteration++;
+                if (monitor != null && monitor.Poll(iteration, r.L2Norm() / bNorm)) break;
             }
+            telemetry?.RecordKrylovSolve(iteration, 2 + 4 * iteration);
             return x;
         }
-        private static Vector<double> SolveMKL(SparseMatrix A, Vector<double> b, Vector<double> x, double threshold, int iterationMax)
+        private static Vector<double> SolveMKL(SparseMatrix A, Vector<double> b, Vector<double> x, double threshold, int iterationMax,
+            KrylovRecycleSpace recycleSpace, SolverTelemetry telemetry, SolverMonitor monitor)
         {
 
             SparseCompressedRowMatrixStorage<double> storage =
@@ -188,12 +199,31 @@ namespace Crane.Core
             int[] csrColInd = storage.ColumnIndices;
             double[] csrVal = storage.Values;
             double[] answer = x.ToArray();
-            NativeMethods.CGNRForRect(n, m, csrRowPtr, csrColInd, csrVal, b.ToArray(), answer, threshold, iterationMax);
+            var before = telemetry != null ? KrylovRecycleSpace.GetThreadStats() : null;
+            if (recycleSpace != null)
+            {
+                // cgnr_mkl は 0 から始めるので、 x0 の分は右辺に移して後で足す
+                bool warm = x.L2Norm() != 0;
+                var residual = warm ? b - A * x : b;
+                answer = new double[m];
+                if (TrySolveRecycled(recycleSpace, monitor, () =>
+                    NativeMethods.CGNRSolveRecycleMkl(n, m, csrRowPtr, csrColInd, csrVal, residual.ToArray(), answer, iterationMax, threshold, recycleSpace)))
+                {
+                    if (warm) for (int i = 0; i < answer.Length; i++) answer[i] += x[i];
+                    RecordNativeSolve(telemetry, before, -1, -1);
+                    return Vector<double>.Build.DenseOfArray(answer);
+                }
+                answer = x.ToArray();
+            }
 
+            // cgnr.dll は統計を持たないので反復回数は記録できない
+            NativeMethods.CGNRForRect(n, m, csrRowPtr, csrColInd, csrVal, b.ToArray(), answer, threshold, iterationMax);
+            RecordNativeSolve(telemetry, null, -1, -1);
             return Vector<double>.Build.DenseOfArray(answer);
         }
 
-        private static Vector<double> SolveArmpl(SparseMatrix A, Vector<double> b, Vector<double> x, double threshold, int iterationMax)
+        private static Vector<double> SolveArmpl(SparseMatrix A, Vector<double> b, Vector<double> x, double threshold, int iterationMax,
+            KrylovRecycleSpace recycleSpace, SolverTelemetry telemetry, SolverMonitor monitor)
         {
             SparseCompressedRowMatrixStorage<double> storage =
             (SparseCompressedRowMatrixStorage<double>)A.Storage;
@@ -203,23 +233,37 @@ namespace Crane.Core
             int[] csrColInd = storage.ColumnIndices;
             double[] csrVal = storage.Values;
             double[] answer = x.ToArray();
-            NativeMethods.CGNRSolve_macOS(n, m, csrRowPtr, csrColInd, csrVal, b.ToArray(), answer, threshold, iterationMax);
+            var before = telemetry != null ? KrylovRecycleSpace.GetThreadStats() : null;
+            if (recycleSpace != null)
+            {
+                if (TrySolveRecycled(recycleSpace, monitor, () =>
+                    NativeMethods.CGNRSolveRecycle_macOS(n, m, csrRowPtr, csrColInd, csrVal, b.ToArray(), answer, threshold, iterationMax, recycleSpace)))
+                {
+                    RecordNativeSolve(telemetry, before, -1, -1);
+                    return Vector<double>.Build.DenseOfArray(answer);
+                }
+                answer = x.ToArray();
+            }
 
+            // 戻り値は反復回数 (負ならエラー)。 SpMV は初期 2 回 + 反復ごとに 2 回
+            int iteration = NativeMethods.CGNRSolve_macOS(n, m, csrRowPtr, csrColInd, csrVal, b.ToArray(), answer, threshold, iterationMax);
+            RecordNativeSolve(telemetry, before, iteration, iteration >= 0 ? 2 + 2 * iteration : -1);
             return Vector<double>.Build.DenseOfArray(answer);
         }
     
-        internal static Vector<double> SolveSym(SparseMatrix A, Vector<double> b, double threshold, int iterationMax)
+        internal static Vector<double> SolveSym(SparseMatrix A, Vector<double> b, double threshold, int iterationMax,
+            KrylovRecycleSpace recycleSpace = null, SolverTelemetry telemetry = null, SolverMonitor monitor = null)
         {
             var cpuArchitecture = RuntimeInformation.ProcessArchitecture;
             if (RuntimeInformation.IsOSPlatform(OSPlatform.Windows))
             {
                 if(cpuArchitecture == Architecture.X64)
                 {
-                    return SolveSymMKL(A, b, threshold, iterationMax);
+                    return SolveSymMKL(A, b, threshold, iterationMax, recycleSpace, telemetry, monitor);
                 }
                 else
                 {
-                    return SolveSymManaged(A, b, threshold, iterationMax);
+                    return SolveSymManaged(A, b, threshold, iterationMax, telemetry, monitor);
                 }
 
             }
@@ -227,19 +271,20 @@ namespace Crane.Core
             {
                 if(cpuArchitecture == Architecture.Arm64)
                 {
-                    return SolveSymArmpl(A, b, threshold, iterationMax);
+                    return SolveSymArmpl(A, b, threshold, iterationMax, recycleSpace, telemetry, monitor);
                 }
                 else
                 {
-                    return SolveSymManaged(A, b, threshold, iterationMax);
+                    return SolveSymManaged(A, b, threshold, iterationMax, telemetry, monitor);
                 }
             }
             else
             {
-                return SolveSymManaged(A, b, threshold, iterationMax);
+                return SolveSymManaged(A, b, threshold, iterationMax, telemetry, monitor);
             }
         }
-        private static Vector<double> SolveSymMKL(SparseMatrix A, Vector<double> b, double threshold, int iterationMax)
+        private static Vector<double> SolveSymMKL(SparseMatrix A, Vector<double> b, double threshold, int iterationMax,
+            KrylovRecycleSpace recycleSpace, SolverTelemetry telemetry, SolverMonitor monitor)
         {
             SparseCompressedRowMatrixStorage<double> storage =
                 (SparseCompressedRowMatrixStorage<double>)A.Storage;
@@ -248,10 +293,25 @@ namespace Crane.Core
             int[] csrColInd = storage.ColumnIndices;
             double[] csrVal = storage.Values;
             double[] answer = new double[n];
+            var before = telemetry != null ? KrylovRecycleSpace.GetThreadStats() : null;
+            if (recycleSpace != null)
+            {
+                if (TrySolveRecycled(recycleSpace, monitor, () =>
+                    NativeMethods.CgSolveRecycleMkl(n, csrRowPtr, csrColInd, csrVal, b.ToArray(), answer, iterationMax, threshold, recycleSpace)))
+                {
+                    RecordNativeSolve(telemetry, before, -1, -1);
+                    return Vector<double>.Build.DenseOfArray(answer);
+                }
+                answer = new double[n];
+            }
+
+            // cgnr.dll は統計を持たないので反復回数は記録できない
             NativeMethods.CGNRForSym(n, csrRowPtr, csrColInd, csrVal, b.ToArray(), answer, threshold, iterationMax);
+            RecordNativeSolve(telemetry, null, -1, -1);
             return Vector<double>.Build.DenseOfArray(answer);
         }
-        private static Vector<double> SolveSymArmpl(SparseMatrix A, Vector<double> b, double threshold, int iterationMax)
+        private static Vector<double> SolveSymArmpl(SparseMatrix A, Vector<double> b, double threshold, int iterationMax,
+            KrylovRecycleSpace recycleSpace, SolverTelemetry telemetry, SolverMonitor monitor)
         {
             SparseCompressedRowMatrixStorage<double> storage =
                 (SparseCompressedRowMatrixStorage<double>)A.Storage;
@@ -260,11 +320,65 @@ namespace Crane.Core
             int[] csrColInd = storage.ColumnIndices;
             double[] csrVal = storage.Values;
             double[] answer = new double[n];
-            NativeMethods.CgSolve(n, csrRowPtr, csrColInd, csrVal, b.ToArray(), answer, threshold, iterationMax);
+            var before = telemetry != null ? KrylovRecycleSpace.GetThreadStats() : null;
+            if (recycleSpace != null)
+            {
+                if (TrySolveRecycled(recycleSpace, monitor, () =>
+                    NativeMethods.CgSolveRecycle(n, csrRowPtr, csrColInd, csrVal, b.ToArray(), answer, threshold, iterationMax, recycleSpace)))
+                {
+                    RecordNativeSolve(telemetry, before, -1, -1);
+                    return Vector<double>.Build.DenseOfArray(answer);
+                }
+                answer = new double[n];
+            }
+
+            // 戻り値は反復回数 (負ならエラー)。 SpMV は反復ごとに 1 回
+            int iteration = NativeMethods.CgSolve(n, csrRowPtr, csrColInd, csrVal, b.ToArray(), answer, threshold, iterationMax);
+            RecordNativeSolve(telemetry, before, iteration, iteration >= 0 ? 1 + iteration : -1);
             return Vector<double>.Build.DenseOfArray(answer);
         }
 
-        private static Vector<double> SolveSymManaged(SparseMatrix A, Vector<double> b, double threshold, int iterationMax)
+        /// <summary>
+        /// Runs a recycled native solve with <paramref name="monitor"/> attached to the workspace.
+        /// Returns false when the solve failed outright (matrix, BLAS or allocation error); the recycled
+        /// subspace is then dropped and the caller solves again with the plain solver. Solves that stopped
+        /// at the iteration limit or were cancelled keep their approximation and return true.
+        /// </summary>
+        private static bool TrySolveRecycled(KrylovRecycleSpace recycleSpace, SolverMonitor monitor, Func<int> solve)
+        {
+            int rc;
+            monitor?.Attach(recycleSpace);
+            try
+            {
+                rc = solve();
+            }
+            finally
+            {
+                monitor?.Detach(recycleSpace);
+            }
+            // cgnr_mkl は中断 (-4) 以外の負値、 cgnr (ArmPL) は -1 / -3 が失敗。 未収束は cgnr_mkl が 1、 cgnr が -2
+            bool failed = KrylovRecycleSpace.IsMkl
+                ? rc < 0 && rc != NativeMethods.SolveCancelled
+                : rc == -1 || rc == -3;
+            if (failed) recycleSpace.Reset();
+            return !failed;
+        }
+
+        /// <summary>
+        /// Records a native solve from the thread statistics taken before it.
+        /// Without them (native library built before cgnr_thread_stats) only the given counts are recorded.
+        /// </summary>
+        private static void RecordNativeSolve(SolverTelemetry telemetry, NativeSolverStats? before, long iterations, long spmv)
+        {
+            if (telemetry == null) return;
+            if (before.HasValue && KrylovRecycleSpace.GetThreadStats() is NativeSolverStats after)
+                telemetry.RecordNativeSolve(before.Value, after);
+            else
+                telemetry.RecordKrylovSolve(iterations, spmv);
+        }
+
+        private static Vector<double> SolveSymManaged(SparseMatrix A, Vector<double> b, double threshold, int iterationMax,
+            SolverTelemetry telemetry = null, SolverMonitor monitor = null)
         {
             Vector<double> x = new DenseVector(A.ColumnCount);
 
@@ -274,6 +388,8 @@ namespace Crane.Core
 
             double alpha, beta;
             int matSize = Math.Min(A.ColumnCount, A.RowCount) + 1;
+            double bNorm = b.L2Norm();
+            if (bNorm == 0) bNorm = 1;
 
             while ((iteration < Math.Min(iterationMax, matSize)) && r.L2Norm() > threshold)
             {
@@ -286,7 +402,9 @@ namespace Crane.Core
                 beta = Math.Pow(r.L2Norm(), 2) / rTr;
                 p = r + beta * p;
                 iteration++;
+                if (monitor != null && monitor.Poll(iteration, r.L2Norm() / bNorm)) break;
             }
+            telemetry?.RecordKrylovSolve(iteration, 2 * iteration);
 
             return x;
         }
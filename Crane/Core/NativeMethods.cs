@@ -16,6 +16,7 @@ namespace Crane.Core
         private static readonly (string logical, string win64, string macArm64, string other)[] Map =
         {
             ("cgnr", "cgnr.dll", "libcgnr.dylib", null),
+            ("cgnr_mkl", "cgnr_mkl.dll", null, null),
             //("gram", "gram.dll", "libgram.dylib", null),
             ("gram", "gram.dll", null, null)
         };
@@ -47,6 +48,17 @@ namespace Crane.Core
             return IntPtr.Zero;                                   // 既定の検索に委ねる
         }
 
+        /// <summary>
+        /// True when the native library <paramref name="logical"/> can be loaded and exports <paramref name="entryPoint"/>.
+        /// Only looks the symbol up; nothing in the library is called.
+        /// </summary>
+        internal static bool HasExport(string logical, string entryPoint)
+        {
+            var asm = typeof(NativeResolver).Assembly;
+            var h = Resolve(logical, asm, null);
+            if (h == IntPtr.Zero && !NativeLibrary.TryLoad(logical, asm, null, out h)) return false;
+            return NativeLibrary.TryGetExport(h, entryPoint, out _);
+        }
     }
     internal static class NativeMethods
     {
@@ -56,6 +68,11 @@ namespace Crane.Core
             _ = typeof(NativeResolver);
         }
 
+        /// <summary>
+        /// Return code of a recycled solve stopped through its monitor (same in cgnr and cgnr_mkl).
+        /// </summary>
+        internal const int SolveCancelled = -4;
+
         [DllImport("cgnr", EntryPoint = "CGNRForRect", CallingConvention = CallingConvention.Cdecl)]
         internal extern static void CGNRForRect(int n, int m, [In] int[] csrRowPtr, [In] int[] csrColInd,
             [In] double[] csrVal, [In] double[] b, [In, Out] double[] x, double threshold, int iterationMax);
@@ -64,7 +81,7 @@ namespace Crane.Core
             [In] double[] csrVal, [In] double[] b, [In, Out] double[] x, double threshold, int iterationMax);
 
         [DllImport("cgnr", EntryPoint = "cgnr_solve_lp64", CallingConvention = CallingConvention.Cdecl)]
-        internal extern static void CGNRSolve_macOS(
+        internal extern static int CGNRSolve_macOS(
             int n, int m,
             int[] rowptr,
             int[] colind,
@@ -81,6 +98,76 @@ namespace Crane.Core
             [In, Out] double[] x,
             double tol, int maxit);
 
+        // cgnr_progress_fn。 0 以外を返すと求解を中断する
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        internal delegate int ProgressCallback(int iteration, double residual, IntPtr user);
+
+        // Krylov 部分空間リサイクル (libcgnr.dylib)
+        [DllImport("cgnr", EntryPoint = "cgnr_recycle_create", CallingConvention = CallingConvention.Cdecl)]
+        internal static extern IntPtr RecycleCreate(int kmax, int lmax);
+        [DllImport("cgnr", EntryPoint = "cgnr_recycle_destroy", CallingConvention = CallingConvention.Cdecl)]
+        internal static extern void RecycleDestroy(IntPtr rec);
+        [DllImport("cgnr", EntryPoint = "cgnr_recycle_reset", CallingConvention = CallingConvention.Cdecl)]
+        internal static extern void RecycleReset(KrylovRecycleSpace rec);
+        [DllImport("cgnr", EntryPoint = "cgnr_recycle_stats", CallingConvention = CallingConvention.Cdecl)]
+        internal static extern void RecycleStats(KrylovRecycleSpace rec, out NativeSolverStats stats);
+        [DllImport("cgnr", EntryPoint = "cgnr_thread_stats", CallingConvention = CallingConvention.Cdecl)]
+        internal static extern void ThreadStats(out NativeSolverStats stats);
+        [DllImport("cgnr", EntryPoint = "cgnr_set_blas_threads_local", CallingConvention = CallingConvention.Cdecl)]
+        internal static extern int SetBlasThreadsLocal(int nthreads);
+        [DllImport("cgnr", EntryPoint = "cgnr_recycle_set_monitor", CallingConvention = CallingConvention.Cdecl)]
+        internal static extern void RecycleSetMonitor(KrylovRecycleSpace rec, ProgressCallback progress, IntPtr user,
+            int every, IntPtr cancel);
+        [DllImport("cgnr", EntryPoint = "cgnr_solve_recycle_lp64", CallingConvention = CallingConvention.Cdecl)]
+        internal static extern int CGNRSolveRecycle_macOS(
+            int n, int m,
+            int[] rowptr, int[] colind, double[] vals,
+            double[] b,
+            [In, Out] double[] x,
+            double tol, int maxit,
+            KrylovRecycleSpace rec);
+        [DllImport("cgnr", EntryPoint = "cg_solve_recycle_lp64", CallingConvention = CallingConvention.Cdecl)]
+        internal static extern int CgSolveRecycle(
+            int n,
+            int[] rowptr, int[] col, double[] vals,
+            double[] b,
+            [In, Out] double[] x,
+            double tol, int maxit,
+            KrylovRecycleSpace rec);
+
+        // Krylov 部分空間リサイクル (cgnr_mkl.dll)
+        [DllImport("cgnr_mkl", EntryPoint = "cgnr_recycle_create", CallingConvention = CallingConvention.Cdecl)]
+        internal static extern IntPtr RecycleCreateMkl(int kmax, int lmax);
+        [DllImport("cgnr_mkl", EntryPoint = "cgnr_recycle_destroy", CallingConvention = CallingConvention.Cdecl)]
+        internal static extern void RecycleDestroyMkl(IntPtr rec);
+        [DllImport("cgnr_mkl", EntryPoint = "cgnr_recycle_reset", CallingConvention = CallingConvention.Cdecl)]
+        internal static extern void RecycleResetMkl(KrylovRecycleSpace rec);
+        [DllImport("cgnr_mkl", EntryPoint = "cgnr_recycle_stats", CallingConvention = CallingConvention.Cdecl)]
+        internal static extern void RecycleStatsMkl(KrylovRecycleSpace rec, out NativeSolverStats stats);
+        [DllImport("cgnr_mkl", EntryPoint = "cgnr_thread_stats", CallingConvention = CallingConvention.Cdecl)]
+        internal static extern void ThreadStatsMkl(out NativeSolverStats stats);
+        [DllImport("cgnr_mkl", EntryPoint = "cgnr_set_blas_threads_local", CallingConvention = CallingConvention.Cdecl)]
+        internal static extern int SetBlasThreadsLocalMkl(int nthreads);
+        [DllImport("cgnr_mkl", EntryPoint = "cgnr_recycle_set_monitor", CallingConvention = CallingConvention.Cdecl)]
+        internal static extern void RecycleSetMonitorMkl(KrylovRecycleSpace rec, ProgressCallback progress, IntPtr user,
+            int every, IntPtr cancel);
+        [DllImport("cgnr_mkl", EntryPoint = "cgnr_solve_csr_double_recycle", CallingConvention = CallingConvention.Cdecl)]
+        internal static extern int CGNRSolveRecycleMkl(
+            int m, int n,
+            int[] Ap, int[] Aj, double[] Ax,
+            double[] b,
+            [In, Out] double[] x,
+            int maxIter, double tol,
+            KrylovRecycleSpace rec);
+        [DllImport("cgnr_mkl", EntryPoint = "cg_solve_csr_double_recycle", CallingConvention = CallingConvention.Cdecl)]
+        internal static extern int CgSolveRecycleMkl(
+            int n,
+            int[] Ap, int[] Aj, double[] Ax,
+            double[] b,
+            [In, Out] double[] x,
+            int maxIter, double tol,
+            KrylovRecycleSpace rec);
+
         [DllImport("gram",
             EntryPoint = "gram_mkl_build_lp64",
             CallingConvention = CallingConvention.Cdecl)]
@@ -92,6 +179,9 @@ namespace Crane.Core
             double w,
             out IntPtr Cp, out IntPtr Cj, out IntPtr Cv);
 
+        [DllImport("gram", EntryPoint = "gram_set_blas_threads_local", CallingConvention = CallingConvention.Cdecl)]
+        internal static extern int SetGramThreadsLocalMkl(int nthreads);
+
         [DllImport("gram",                     // libgram25.dylib / .so
             EntryPoint = "gram25_build_lp64",
             CallingConvention = CallingConvention.Cdecl)]
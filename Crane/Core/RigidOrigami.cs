@@ -36,6 +36,7 @@ namespace Crane.Core
             this.IsFoldBlockMode = rigidOrigami.IsFoldBlockMode;
             this.IsConstraintMode = rigidOrigami.IsConstraintMode;
             this.IsRecordMode = rigidOrigami.IsRecordMode;
+            this.IsRecycleMode = rigidOrigami.IsRecycleMode;
             this.CGNRComputationSpeeds = new List<List<double>>();
             this.NRComputationSpeeds = new List<double>();
             NowRecordedIndexPosition = 0;
@@ -54,6 +55,7 @@ namespace Crane.Core
             this.IsFoldBlockMode = false;
             this.IsConstraintMode = false;
             this.IsRecordMode = false;
+            this.IsRecycleMode = false;
             this.CGNRComputationSpeeds = new List<List<double>>();
             this.NRComputationSpeeds = new List<double>();
             NowRecordedIndexPosition = 0;
@@ -70,6 +72,13 @@ namespace Crane.Core
         public bool IsFoldBlockMode { get; set; }
         public bool IsConstraintMode { get; set; }
         public bool IsRecordMode { get; set; }
+        /// <summary>
+        /// If true, consecutive native CG / CGNR solves share a recycled Krylov subspace
+        /// so that the near-mechanism directions are not rediscovered at every step.
+        /// Off by default for scripted use; the solver components turn it on through their Recycle input.
+        /// Falls back to the plain solvers when the native library does not export the recycled ones.
+        /// </summary>
+        public bool IsRecycleMode { get; set; }
         public SparseMatrix Jacobian { get; protected set; }
         public Vector<double> Error { get; protected set; }
         public double Residual { get; protected set; }
@@ -77,6 +86,17 @@ namespace Crane.Core
         public List<int> MoveVertexIndices { get; set; }
         public List<List<double>> CGNRComputationSpeeds { get; private set; }
         public List<double> NRComputationSpeeds { get; private set; }
+        /// <summary>
+        /// Per-phase timers and counters of this solver (constraint evaluation, Jacobian assembly,
+        /// Gram build, Krylov solve, line search, mesh update).
+        /// </summary>
+        public SolverTelemetry Telemetry { get; private set; } = new SolverTelemetry();
+        /// <summary>
+        /// If set, the solves poll its cancellation token (also inside the Krylov iterations) and report
+        /// Krylov progress to it (the native solvers only with <see cref="IsRecycleMode"/> on). A cancelled NRSolve
+        /// throws OperationCanceledException and leaves the mesh at the last completed Newton step.
+        /// </summary>
+        public SolverMonitor Monitor { get; set; }
         public bool UseNative { get; set; }
 
         public int NowRecordedIndexPosition { get; set; }
@@ -88,10 +108,12 @@ namespace Crane.Core
         protected MountainIntersectPenalty MountainIntersectPenalty = new MountainIntersectPenalty();
         protected ValleyIntersectPenalty ValleyIntersectPenalty = new ValleyIntersectPenalty();
         protected static object lockObj = new object();
+        private SolverWorkspace workspace;
         #endregion
 
         protected void ComputeError()
         {
+            using var scope = Telemetry.Measure(SolverPhase.ConstraintEvaluation);
             int n = this.CMesh.Mesh.Vertices.Count * 3;
             List<double> errorList = new List<double>();
             if (IsRigidMode)
@@ -136,6 +158,7 @@ namespace Crane.Core
         }
         protected void ComputeJacobian()
         {
+            using var scope = Telemetry.Measure(SolverPhase.JacobianAssembly);
             SparseMatrixBuilder builder = new SparseMatrixBuilder(0, CMesh.DOF);
             if (IsRigidMode)
             {
@@ -311,6 +334,7 @@ namespace Crane.Core
         }
         protected SparseMatrix ComputeFoldMotionMatrix(SparseMatrix foldAngleJacobian, SparseMatrix jacobian, double weight)
         {
+            using var scope = Telemetry.Measure(SolverPhase.GramBuild);
             return LinearAlgebra.Gram(foldAngleJacobian, jacobian, weight);
         }
         protected Vector<double> ComputeFoldMotionVector(Matrix<double> foldAngleJacobian, Vector<double> initialFoldAngleVector)
@@ -385,7 +409,12 @@ namespace Crane.Core
                 drivingForce = ComputeInitialFoldAngleVectorForFold(foldSpeed);
             }
             Vector<double> b = ComputeFoldMotionVector(foldJacobian, drivingForce);
-            Vector<double> foldMotion = -LinearAlgebra.SolveSym(A, b, 1e-6, iterationMax);
+            Vector<double> foldMotion;
+            using (Telemetry.Measure(SolverPhase.KrylovSolve))
+            {
+                foldMotion = -LinearAlgebra.SolveSym(A, b, 1e-6, iterationMax, IsRecycleMode ? Workspace.FoldMotion : null, Telemetry, Monitor);
+            }
+            Monitor?.ThrowIfCancellationRequested();
 
             return foldMotion;
         }
@@ -417,6 +446,7 @@ namespace Crane.Core
 
         protected void LinearSearch(Vector<double> vector, int maxIter)
         {
+            using var scope = Telemetry.Measure(SolverPhase.LineSearch);
             double goldenRatio = (Math.Sqrt(5) - 1) / 2;
             Vector<double> nowCoordinates = 1.0 * CMesh.MeshVerticesVector;
 
@@ -436,17 +466,10 @@ namespace Crane.Core
                 double e1, e2; // 内分点での誤差値
 
                 x1 = 1 / (goldenRatio + 1) * (goldenRatio * lb + ub);
-                Vector<double> updateVector = nowCoordinates + x1;
-                CMesh.UpdateMesh(updateVector);
-                ComputeError();
-                e1 = Error.L2Norm();
+                e1 = ProbeLineSearch(nowCoordinates + x1);
 
                 x2 = 1 / (goldenRatio + 1) * (lb + goldenRatio * ub);
-                updateVector = nowCoordinates + x2;
-
-                this.CMesh.UpdateMesh(updateVector);
-                ComputeError();
-                e2 = Error.L2Norm();
+                e2 = ProbeLineSearch(nowCoordinates + x2);
 
                 for (int i = 0; i < maxIter; i++)
                 {
@@ -456,10 +479,7 @@ namespace Crane.Core
                         x2 = x1;
                         e2 = e1;
                         x1 = (1 / (goldenRatio + 1)) * (ub - lb) + lb;
-                        updateVector = nowCoordinates + x1;
-                        this.CMesh.UpdateMesh(updateVector);
-                        ComputeError();
-                        e1 = Error.L2Norm();
+                        e1 = ProbeLineSearch(nowCoordinates + x1);
                     }
                     else
                     {
@@ -467,22 +487,60 @@ namespace Crane.Core
                         x1 = x2;
                         e1 = e2;
                         x2 = (1 / goldenRatio) * (ub - lb) + lb;
-                        updateVector = nowCoordinates + x2;
-                        this.CMesh.UpdateMesh(updateVector);
-                        ComputeError();
-                        e2 = Error.L2Norm();
+                        e2 = ProbeLineSearch(nowCoordinates + x2);
                     }
                 }
                 //updatedCoordinates = nowCoordinates + 0.5 * (lb + ub);
                 updatedCoordinates = nowCoordinates + ub;
             }
 
-            this.CMesh.UpdateMesh(updatedCoordinates);
+            UpdateMesh(updatedCoordinates);
             ComputeJacobian();
             ComputeError();
 
         }
 
+        protected void UpdateMesh(Vector<double> meshVerticesVector)
+        {
+            using var scope = Telemetry.Measure(SolverPhase.MeshUpdate);
+            CMesh.UpdateMesh(meshVerticesVector);
+        }
+
+        /// <summary>
+        /// Evaluates one line search probe and returns its error norm.
+        /// </summary>
+        private double ProbeLineSearch(Vector<double> coordinates)
+        {
+            Telemetry.Count(SolverCounter.LineSearchProbes);
+            UpdateMesh(coordinates);
+            ComputeError();
+            return Error.L2Norm();
+        }
+
+        /// <summary>
+        /// CGNR for the Newton step. Returns the elapsed time in milliseconds.
+        /// </summary>
+        private double SolveNewtonStep(Vector<double> initialMoveVector, int iterationMax, out Vector<double> moveVector)
+        {
+            long start = System.Diagnostics.Stopwatch.GetTimestamp();
+            using (Telemetry.Measure(SolverPhase.KrylovSolve))
+            {
+                moveVector = -LinearAlgebra.Solve(Jacobian, Error, initialMoveVector, Residual, iterationMax, IsRecycleMode ? Workspace.Cgnr : null, Telemetry, Monitor);
+            }
+            // 中断された Krylov 解で直線探索しない
+            Monitor?.ThrowIfCancellationRequested();
+            return (System.Diagnostics.Stopwatch.GetTimestamp() - start) * 1000.0 / System.Diagnostics.Stopwatch.Frequency;
+        }
+
+        /// <summary>
+        /// Native solver workspace. Created on first use unless a batch worker attaches its own.
+        /// </summary>
+        internal SolverWorkspace Workspace
+        {
+            get => workspace ??= new SolverWorkspace();
+            set => workspace = value;
+        }
+
         public double ComputeResidual()
         {
             ComputeError();
@@ -508,6 +566,8 @@ namespace Crane.Core
         public double NRSolve(Vector<double> initialMoveVector, double threshold, int iterationMaxNewtonMethod, int iterationMaxCGNR)
         {
             bool useNativeCGNRMethod = true;
+            using var scope = Telemetry.Measure(SolverPhase.NewtonSolve);
+            long allocatedBytes = GC.GetAllocatedBytesForCurrentThread();
             ComputeJacobian();
             Residual = ComputeResidual();
             var cgnrComp = new List<double>();
@@ -515,28 +575,30 @@ namespace Crane.Core
             if(initialMoveVector.L2Norm() != 0)
             {
                 int cgnrIterationMax = Math.Min(Math.Min(Jacobian.RowCount, Jacobian.ColumnCount) - 1, iterationMaxCGNR);
-                constrainedMoveVector = -LinearAlgebra.Solve(Jacobian, Error, initialMoveVector, Residual, cgnrIterationMax);
+                cgnrComp.Add(SolveNewtonStep(initialMoveVector, cgnrIterationMax, out constrainedMoveVector));
                 LinearSearch(constrainedMoveVector, 0);
                 Residual = ComputeResidualNoEvaluation();
             }
             int iteration = 0;
-            cgnrComp = new List<double>();
             double nrComp;
             var nrSw = new System.Diagnostics.Stopwatch();
             nrSw.Start();
             while(iteration < iterationMaxNewtonMethod && Residual > threshold)
             {
+                Monitor?.ThrowIfCancellationRequested();
                 Vector<double> zeroVector = SparseVector.Build.Sparse(this.CMesh.DOF);
                 int cgnrIterationMax = Math.Min(Math.Min(Jacobian.RowCount, Jacobian.ColumnCount), iterationMaxCGNR);
-                constrainedMoveVector = -LinearAlgebra.Solve(Jacobian, Error, zeroVector, Residual, cgnrIterationMax);
+                cgnrComp.Add(SolveNewtonStep(zeroVector, cgnrIterationMax, out constrainedMoveVector));
                 LinearSearch(constrainedMoveVector, 5);
                 Residual = ComputeResidualNoEvaluation();
                 iteration++;
             }
             nrSw.Stop();
-            nrComp = nrSw.ElapsedMilliseconds;
+            nrComp = nrSw.Elapsed.TotalMilliseconds;
             NRComputationSpeeds.Add(nrComp);
             CGNRComputationSpeeds.Add(cgnrComp);
+            Telemetry.Count(SolverCounter.NewtonIterations, iteration);
+            Telemetry.Count(SolverCounter.ManagedAllocatedBytes, GC.GetAllocatedBytesForCurrentThread() - allocatedBytes);
 
             if (true)
             {
@@ -0,0 +1,97 @@
+﻿using System;
+using System.Runtime.InteropServices;
+using System.Threading;
+
+namespace Crane.Core
+{
+    /// <summary>
+    /// Cancellation and progress reporting for a running solve.
+    /// The native recycled solvers read the cancellation flag every Krylov iteration and call
+    /// <see cref="Progress"/> every <see cref="ProgressInterval"/> iterations, so a stale solve stops
+    /// within one iteration instead of at the end of the CGNR call. The managed fallback solvers do the same.
+    /// </summary>
+    public sealed class SolverMonitor : IDisposable
+    {
+        private IntPtr cancelFlag;
+        private CancellationTokenRegistration registration;
+        // ネイティブ側が関数ポインタを保持している間 GC されないようにフィールドで持つ
+        private readonly NativeMethods.ProgressCallback callback;
+
+        /// <param name="progress">Called with (Krylov iteration, relative residual ‖b − Ax‖ / ‖b‖) on the solver thread. Exceptions are ignored.</param>
+        /// <param name="progressInterval">Krylov iterations between two progress calls. 0 or less disables progress.</param>
+        public SolverMonitor(CancellationToken cancellationToken, Action<int, double> progress = null, int progressInterval = 10)
+        {
+            CancellationToken = cancellationToken;
+            Progress = progress;
+            ProgressInterval = progressInterval;
+            callback = OnNativeProgress;
+
+            cancelFlag = Marshal.AllocHGlobal(sizeof(int));
+            Marshal.WriteInt32(cancelFlag, 0);
+            registration = cancellationToken.Register(() => Marshal.WriteInt32(cancelFlag, 1));
+        }
+
+        public CancellationToken CancellationToken { get; }
+        public Action<int, double> Progress { get; }
+        public int ProgressInterval { get; }
+        public bool IsCancellationRequested => CancellationToken.IsCancellationRequested;
+
+        public void ThrowIfCancellationRequested()
+        {
+            CancellationToken.ThrowIfCancellationRequested();
+        }
+
+        /// <summary>
+        /// Called by the managed solvers after each iteration with the relative residual. Returns true when the solve should stop.
+        /// </summary>
+        internal bool Poll(int iteration, double residual)
+        {
+            if (CancellationToken.IsCancellationRequested) return true;
+            if (Progress != null && ProgressInterval > 0 && iteration % ProgressInterval == 0)
+                Report(iteration, residual);
+            return CancellationToken.IsCancellationRequested;
+        }
+
+        /// <summary>
+        /// Installs this monitor on the native workspace for the next solves. Call <see cref="Detach"/> afterwards.
+        /// </summary>
+        internal void Attach(KrylovRecycleSpace recycleSpace)
+        {
+            recycleSpace?.SetMonitor(Progress != null ? callback : null, ProgressInterval, cancelFlag);
+        }
+
+        internal void Detach(KrylovRecycleSpace recycleSpace)
+        {
+            recycleSpace?.SetMonitor(null, 0, IntPtr.Zero);
+        }
+
+        public void Dispose()
+        {
+            // 登録解除はコールバックの実行完了を待つので、 その後なら解放してよい
+            registration.Dispose();
+            if (cancelFlag != IntPtr.Zero)
+            {
+                Marshal.FreeHGlobal(cancelFlag);
+                cancelFlag = IntPtr.Zero;
+            }
+        }
+
+        private int OnNativeProgress(int iteration, double residual, IntPtr user)
+        {
+            Report(iteration, residual);
+            return CancellationToken.IsCancellationRequested ? 1 : 0;
+        }
+
+        private void Report(int iteration, double residual)
+        {
+            try
+            {
+                Progress?.Invoke(iteration, residual);
+            }
+            catch (Exception)
+            {
+                // 進捗表示の失敗で求解を止めない
+            }
+        }
+    }
+}
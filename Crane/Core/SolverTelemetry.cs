@@ -0,0 +1,401 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+using System.Numerics;
+using System.Text;
+using System.Text.Json;
+using System.Threading;
+
+namespace Crane.Core
+{
+    /// <summary>
+    /// Phases of the rigid origami solver measured by <see cref="SolverTelemetry"/>.
+    /// Phases may nest (e.g. LineSearch contains ConstraintEvaluation and MeshUpdate), so the times are inclusive.
+    /// The Native* phases are measured inside the native solvers and nest in KrylovSolve.
+    /// </summary>
+    public enum SolverPhase
+    {
+        NewtonSolve,
+        ConstraintEvaluation,
+        JacobianAssembly,
+        GramBuild,
+        KrylovSolve,
+        LineSearch,
+        MeshUpdate,
+        NativeSetup,
+        NativeIteration,
+        NativeSubspaceUpdate,
+    }
+
+    public enum SolverCounter
+    {
+        NewtonIterations,
+        KrylovSolves,
+        KrylovIterations,
+        SpMV,
+        LineSearchProbes,
+        NativeAllocations,
+        NativeSolveNanoseconds,
+        ManagedAllocatedBytes,
+    }
+
+    /// <summary>
+    /// Histogram with power-of-two buckets. Bucket 0 counts 0, bucket i counts values in [2^(i-1), 2^i).
+    /// </summary>
+    public sealed class Log2Histogram
+    {
+        public const int BucketCount = 32;
+        private readonly long[] buckets = new long[BucketCount];
+
+        public void Add(long value)
+        {
+            int i = value <= 0 ? 0 : Math.Min(BucketCount - 1, 64 - BitOperations.LeadingZeroCount((ulong)value));
+            Interlocked.Increment(ref buckets[i]);
+        }
+
+        public long[] ToArray()
+        {
+            var copy = new long[BucketCount];
+            for (int i = 0; i < BucketCount; i++) copy[i] = Interlocked.Read(ref buckets[i]);
+            return copy;
+        }
+
+        public void Clear()
+        {
+            for (int i = 0; i < BucketCount; i++) Interlocked.Exchange(ref buckets[i], 0);
+        }
+
+        /// <summary>
+        /// Upper bound (exclusive) of the bucket.
+        /// </summary>
+        public static long UpperBound(int bucket) => bucket == 0 ? 1 : 1L << Math.Min(bucket, 62);
+    }
+
+    public readonly struct PhaseStatistics
+    {
+        public PhaseStatistics(SolverPhase phase, long count, double totalMilliseconds, double maxMilliseconds, long[] histogram)
+        {
+            Phase = phase;
+            Count = count;
+            TotalMilliseconds = totalMilliseconds;
+            MaxMilliseconds = maxMilliseconds;
+            Histogram = histogram;
+        }
+        public SolverPhase Phase { get; }
+        public long Count { get; }
+        public double TotalMilliseconds { get; }
+        public double MeanMilliseconds => Count == 0 ? 0 : TotalMilliseconds / Count;
+        public double MaxMilliseconds { get; }
+        /// <summary>
+        /// Durations in microseconds, see <see cref="Log2Histogram"/>.
+        /// </summary>
+        public long[] Histogram { get; }
+    }
+
+    /// <summary>
+    /// Low-overhead per-phase timers, counters and histograms of a solver instance.
+    /// Recording is expected from one solver thread at a time; the query methods may be called from any thread.
+    /// When <see cref="IsTracing"/> is on, the individual phase spans are also kept in a ring buffer
+    /// and can be exported as a Chrome trace (chrome://tracing, Perfetto).
+    /// </summary>
+    public sealed class SolverTelemetry
+    {
+        public const int TraceCapacity = 1 << 16;
+
+        private static readonly int PhaseCount = Enum.GetValues(typeof(SolverPhase)).Length;
+        private static readonly int CounterCount = Enum.GetValues(typeof(SolverCounter)).Length;
+        private static readonly double TicksToMicroseconds = 1e6 / Stopwatch.Frequency;
+        private static readonly double NanosecondsToTicks = Stopwatch.Frequency / 1e9;
+
+        private readonly long[] phaseCounts = new long[PhaseCount];
+        private readonly long[] phaseTicks = new long[PhaseCount];
+        private readonly long[] phaseMaxTicks = new long[PhaseCount];
+        private readonly Log2Histogram[] phaseHistograms = new Log2Histogram[PhaseCount];
+        private readonly long[] counters = new long[CounterCount];
+        private readonly Log2Histogram krylovIterationHistogram = new Log2Histogram();
+
+        private readonly object traceLock = new object();
+        private TraceEvent[] trace;
+        private int traceNext;
+        private bool traceWrapped;
+        private long originTicks;
+
+        private struct TraceEvent
+        {
+            public SolverPhase Phase;
+            public long Start;
+            public long Duration;
+            public int ThreadId;
+        }
+
+        public SolverTelemetry()
+        {
+            for (int i = 0; i < PhaseCount; i++) phaseHistograms[i] = new Log2Histogram();
+            originTicks = Stopwatch.GetTimestamp();
+        }
+
+        public bool IsEnabled { get; set; } = true;
+        public bool IsTracing { get; set; } = false;
+
+        #region Recording
+        /// <summary>
+        /// Starts timing a phase. Dispose the returned scope to stop it.
+        /// </summary>
+        public PhaseScope Measure(SolverPhase phase)
+        {
+            return IsEnabled ? new PhaseScope(this, phase, Stopwatch.GetTimestamp()) : default;
+        }
+
+        public void Count(SolverCounter counter, long value = 1)
+        {
+            if (!IsEnabled) return;
+            Interlocked.Add(ref counters[(int)counter], value);
+        }
+
+        /// <summary>
+        /// Records one Krylov solve. Unknown quantities are passed as negative values.
+        /// </summary>
+        public void RecordKrylovSolve(long iterations, long spmv)
+        {
+            if (!IsEnabled) return;
+            Count(SolverCounter.KrylovSolves);
+            if (iterations >= 0)
+            {
+                Count(SolverCounter.KrylovIterations, iterations);
+                krylovIterationHistogram.Add(iterations);
+            }
+            if (spmv >= 0) Count(SolverCounter.SpMV, spmv);
+        }
+
+        /// <summary>
+        /// Records the difference of the cumulative native statistics around a native solve that just returned.
+        /// The native phase times become back-to-back spans ending now.
+        /// </summary>
+        internal void RecordNativeSolve(NativeSolverStats before, NativeSolverStats after)
+        {
+            if (!IsEnabled || after.Solves == before.Solves) return;
+            RecordKrylovSolve(after.Iterations - before.Iterations, after.SpMV - before.SpMV);
+            Count(SolverCounter.NativeAllocations, after.Allocations - before.Allocations);
+            Count(SolverCounter.NativeSolveNanoseconds, after.SolveNanoseconds - before.SolveNanoseconds);
+
+            long end = Stopwatch.GetTimestamp();
+            long update = (long)((after.UpdateNanoseconds - before.UpdateNanoseconds) * NanosecondsToTicks);
+            long iterate = (long)((after.IterateNanoseconds - before.IterateNanoseconds) * NanosecondsToTicks);
+            long setup = (long)((after.SetupNanoseconds - before.SetupNanoseconds) * NanosecondsToTicks);
+            Record(SolverPhase.NativeSubspaceUpdate, end - update, end);
+            Record(SolverPhase.NativeIteration, end - update - iterate, end - update);
+            Record(SolverPhase.NativeSetup, end - update - iterate - setup, end - update - iterate);
+        }
+
+        private void Record(SolverPhase phase, long start, long end)
+        {
+            int i = (int)phase;
+            long ticks = end - start;
+            Interlocked.Increment(ref phaseCounts[i]);
+            Interlocked.Add(ref phaseTicks[i], ticks);
+            if (ticks > Volatile.Read(ref phaseMaxTicks[i])) Volatile.Write(ref phaseMaxTicks[i], ticks);
+            phaseHistograms[i].Add((long)(ticks * TicksToMicroseconds));
+
+            if (!IsTracing) return;
+            lock (traceLock)
+            {
+                trace ??= new TraceEvent[TraceCapacity];
+                trace[traceNext] = new TraceEvent
+                {
+                    Phase = phase,
+                    Start = start,
+                    Duration = ticks,
+                    ThreadId = Environment.CurrentManagedThreadId,
+                };
+                if (++traceNext == TraceCapacity) { traceNext = 0; traceWrapped = true; }
+            }
+        }
+
+        public readonly struct PhaseScope : IDisposable
+        {
+            private readonly SolverTelemetry owner;
+            private readonly SolverPhase phase;
+            private readonly long start;
+
+            internal PhaseScope(SolverTelemetry owner, SolverPhase phase, long start)
+            {
+                this.owner = owner;
+                this.phase = phase;
+                this.start = start;
+            }
+
+            public void Dispose()
+            {
+                owner?.Record(phase, start, Stopwatch.GetTimestamp());
+            }
+        }
+        #endregion
+
+        #region Query
+        public PhaseStatistics GetPhaseStatistics(SolverPhase phase)
+        {
+            int i = (int)phase;
+            double toMs = 1000.0 / Stopwatch.Frequency;
+            return new PhaseStatistics(phase,
+                Interlocked.Read(ref phaseCounts[i]),
+                Interlocked.Read(ref phaseTicks[i]) * toMs,
+                Volatile.Read(ref phaseMaxTicks[i]) * toMs,
+                phaseHistograms[i].ToArray());
+        }
+
+        public long GetCounter(SolverCounter counter)
+        {
+            return Interlocked.Read(ref counters[(int)counter]);
+        }
+
+        /// <summary>
+        /// Number of Krylov iterations per solve, see <see cref="Log2Histogram"/>.
+        /// </summary>
+        public long[] GetKrylovIterationHistogram()
+        {
+            return krylovIterationHistogram.ToArray();
+        }
+
+        public void Reset()
+        {
+            for (int i = 0; i < PhaseCount; i++)
+            {
+                Interlocked.Exchange(ref phaseCounts[i], 0);
+                Interlocked.Exchange(ref phaseTicks[i], 0);
+                Interlocked.Exchange(ref phaseMaxTicks[i], 0);
+                phaseHistograms[i].Clear();
+            }
+            for (int i = 0; i < CounterCount; i++) Interlocked.Exchange(ref counters[i], 0);
+            krylovIterationHistogram.Clear();
+            lock (traceLock)
+            {
+                traceNext = 0;
+                traceWrapped = false;
+                originTicks = Stopwatch.GetTimestamp();
+            }
+        }
+        #endregion
+
+        #region Export
+        /// <summary>
+        /// Summary of all phases, counters and histograms as JSON.
+        /// </summary>
+        public string ToJson()
+        {
+            using var stream = new MemoryStream();
+            using (var writer = new Utf8JsonWriter(stream, new JsonWriterOptions { Indented = true }))
+            {
+                writer.WriteStartObject();
+                writer.WriteStartObject("phases");
+                foreach (SolverPhase phase in Enum.GetValues(typeof(SolverPhase)))
+                {
+                    var stats = GetPhaseStatistics(phase);
+                    writer.WriteStartObject(phase.ToString());
+                    writer.WriteNumber("count", stats.Count);
+                    writer.WriteNumber("totalMs", stats.TotalMilliseconds);
+                    writer.WriteNumber("meanMs", stats.MeanMilliseconds);
+                    writer.WriteNumber("maxMs", stats.MaxMilliseconds);
+                    WriteHistogram(writer, "histogramUs", stats.Histogram);
+                    writer.WriteEndObject();
+                }
+                writer.WriteEndObject();
+
+                writer.WriteStartObject("counters");
+                foreach (SolverCounter counter in Enum.GetValues(typeof(SolverCounter)))
+                    writer.WriteNumber(counter.ToString(), GetCounter(counter));
+                writer.WriteEndObject();
+
+                WriteHistogram(writer, "krylovIterationHistogram", GetKrylovIterationHistogram());
+                writer.WriteEndObject();
+            }
+            return Encoding.UTF8.GetString(stream.ToArray());
+        }
+
+        /// <summary>
+        /// Writes the recorded phase spans in the Chrome trace event format.
+        /// Only available while <see cref="IsTracing"/> is on; the oldest spans are overwritten
+        /// after <see cref="TraceCapacity"/> events.
+        /// </summary>
+        public void WriteChromeTrace(Stream stream)
+        {
+            TraceEvent[] events;
+            long origin;
+            lock (traceLock)
+            {
+                origin = originTicks;
+                if (trace == null)
+                {
+                    events = Array.Empty<TraceEvent>();
+                }
+                else if (traceWrapped)
+                {
+                    events = new TraceEvent[TraceCapacity];
+                    Array.Copy(trace, traceNext, events, 0, TraceCapacity - traceNext);
+                    Array.Copy(trace, 0, events, TraceCapacity - traceNext, traceNext);
+                }
+                else
+                {
+                    events = new TraceEvent[traceNext];
+                    Array.Copy(trace, events, traceNext);
+                }
+            }
+
+            using var writer = new Utf8JsonWriter(stream);
+            writer.WriteStartObject();
+            writer.WriteStartArray("traceEvents");
+            var threads = new HashSet<int>();
+            foreach (var e in events)
+            {
+                writer.WriteStartObject();
+                writer.WriteString("name", e.Phase.ToString());
+                writer.WriteString("cat", "crane");
+                writer.WriteString("ph", "X");
+                writer.WriteNumber("ts", (e.Start - origin) * TicksToMicroseconds);
+                writer.WriteNumber("dur", e.Duration * TicksToMicroseconds);
+                writer.WriteNumber("pid", 1);
+                writer.WriteNumber("tid", e.ThreadId);
+                writer.WriteEndObject();
+                threads.Add(e.ThreadId);
+            }
+            foreach (int tid in threads)
+            {
+                writer.WriteStartObject();
+                writer.WriteString("name", "thread_name");
+                writer.WriteString("ph", "M");
+                writer.WriteNumber("pid", 1);
+                writer.WriteNumber("tid", tid);
+                writer.WriteStartObject("args");
+                writer.WriteString("name", $"Crane solver {tid}");
+                writer.WriteEndObject();
+                writer.WriteEndObject();
+            }
+            writer.WriteEndArray();
+            writer.WriteString("displayTimeUnit", "ms");
+            writer.WriteEndObject();
+        }
+
+        public string ToChromeTrace()
+        {
+            using var stream = new MemoryStream();
+            WriteChromeTrace(stream);
+            return Encoding.UTF8.GetString(stream.ToArray());
+        }
+
+        public void ExportChromeTrace(string path)
+        {
+            using var stream = File.Create(path);
+            WriteChromeTrace(stream);
+        }
+
+        private static void WriteHistogram(Utf8JsonWriter writer, string name, long[] histogram)
+        {
+            int last = histogram.Length - 1;
+            while (last > 0 && histogram[last] == 0) last--;
+            writer.WriteStartArray(name);
+            for (int i = 0; i <= last; i++) writer.WriteNumberValue(histogram[i]);
+            writer.WriteEndArray();
+        }
+        #endregion
+    }
+}
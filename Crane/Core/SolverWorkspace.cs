@@ -0,0 +1,72 @@
+﻿using System;
+
+namespace Crane.Core
+{
+    /// <summary>
+    /// Native solver buffers (recycled Krylov subspaces) owned by one solver thread.
+    /// A workspace can be handed from one RigidOrigami to the next to reuse its buffers;
+    /// call <see cref="Reset"/> in between since the recycled subspace belongs to the previous model.
+    /// </summary>
+    internal sealed class SolverWorkspace : IDisposable
+    {
+        private KrylovRecycleSpace cgnr;
+        private KrylovRecycleSpace foldMotion;
+
+        internal KrylovRecycleSpace Cgnr => cgnr ??= KrylovRecycleSpace.Create();
+        internal KrylovRecycleSpace FoldMotion => foldMotion ??= KrylovRecycleSpace.Create();
+
+        internal void Reset()
+        {
+            cgnr?.Reset();
+            foldMotion?.Reset();
+        }
+
+        public void Dispose()
+        {
+            cgnr?.Dispose();
+            foldMotion?.Dispose();
+            cgnr = null;
+            foldMotion = null;
+        }
+
+        /// <summary>
+        /// Sets the number of BLAS threads used on the calling thread by the native solvers and the native Gram build.
+        /// 0 restores the global setting. Returns false when a native library that runs here has no per-thread setting.
+        /// See <see cref="CanLimitBlasThreads"/> for which solves the setting reaches.
+        /// </summary>
+        internal static bool SetBlasThreadsLocal(int threads)
+        {
+            if (!KrylovRecycleSpace.IsMkl) return true;
+            bool limited = true;
+            try
+            {
+                NativeMethods.SetBlasThreadsLocalMkl(threads);
+            }
+            catch (DllNotFoundException) { limited = false; }
+            catch (EntryPointNotFoundException) { limited = false; }
+            try
+            {
+                NativeMethods.SetGramThreadsLocalMkl(threads);
+            }
+            catch (DllNotFoundException) { limited = false; }
+            catch (EntryPointNotFoundException) { limited = false; }
+            return limited;
+        }
+
+        /// <summary>
+        /// True when <see cref="SetBlasThreadsLocal"/> limits every native solve of a model solved with the given recycle mode.
+        /// Only looks the native exports up and changes no setting, so it can be called from any thread.
+        /// The ArmPL libraries link the serial ArmPL and always run on one thread. On Windows the plain CGNRForRect /
+        /// CGNRForSym of cgnr.dll are built outside this repository and always use MKL's default threading, so only the
+        /// recycled solves of cgnr_mkl.dll can be limited; the Gram build needs a gram.dll with gram_set_blas_threads_local.
+        /// </summary>
+        internal static bool CanLimitBlasThreads(bool isRecycleMode)
+        {
+            if (!KrylovRecycleSpace.IsMkl) return true;
+            return isRecycleMode
+                && NativeResolver.HasExport("cgnr_mkl", "cgnr_solve_csr_double_recycle")
+                && NativeResolver.HasExport("cgnr_mkl", "cgnr_set_blas_threads_local")
+                && NativeResolver.HasExport("gram", "gram_set_blas_threads_local");
+        }
+    }
+}
@@ -270,6 +270,16 @@ namespace Crane.Properties {
             }
         }
         
+        /// <summary>
+        ///   型 System.Drawing.Bitmap のローカライズされたリソースを検索します。
+        /// </summary>
+        internal static System.Drawing.Bitmap icons_batch_solver {
+            get {
+                object obj = ResourceManager.GetObject("icons_batch_solver", resourceCulture);
+                return ((System.Drawing.Bitmap)(obj));
+            }
+        }
+        
         /// <summary>
         ///   型 System.Drawing.Bitmap のローカライズされたリソースを検索します。
         /// </summary>
@@ -1000,6 +1010,16 @@ namespace Crane.Properties {
             }
         }
         
+        /// <summary>
+        ///   型 System.Drawing.Bitmap のローカライズされたリソースを検索します。
+        /// </summary>
+        internal static System.Drawing.Bitmap icons_solver_telemetry {
+            get {
+                object obj = ResourceManager.GetObject("icons_solver_telemetry", resourceCulture);
+                return ((System.Drawing.Bitmap)(obj));
+            }
+        }
+        
         /// <summary>
         ///   型 System.Drawing.Bitmap のローカライズされたリソースを検索します。
         /// </summary>
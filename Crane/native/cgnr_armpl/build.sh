@@ -6,10 +6,11 @@ cp ../lib/libarmpl_lp64.dylib ./
 clang -std=c11 -O3 -fvisibility=hidden \
       -I../include -I$ARMPL_DIR/include \
       -c ../src/cgnr_solver.c \
-      -c ../src/cg_solver.c      
+      -c ../src/cg_solver.c \
+      -c ../src/recycle.c
 
 clang -shared -o libcgnr.dylib \
-      cgnr_solver.o cg_solver.o \
+      cgnr_solver.o cg_solver.o recycle.o \
       -L./ -larmpl_lp64 -lpthread -lm \
       -Wl,-install_name,@rpath/libcgnr.dylib \
       -Wl,-rpath,@loader_path
\ No newline at end of file
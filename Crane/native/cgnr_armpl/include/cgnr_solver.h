@@ -7,6 +7,7 @@
  *          -1  行列生成エラー
  *          -2  最大反復で収束せず
  *          -3  ArmPL API 失敗
+ *          -4  中断 (cgnr_recycle_set_monitor)
  */
 #ifdef __cplusplus
 extern "C" {
@@ -50,6 +51,92 @@ int cg_solve_lp64(
  */
 
 
+/* ───────────────────────────────────────────────────────── */
+/* Krylov 部分空間リサイクル (deflated CG / CGNR)
+ *   連続する求解の間で近特異ベクトル (メカニズム方向) の小さな部分空間を
+ *   保持し、次回以降の求解からデフレーションする。
+ *   ハンドルは 1 つの系列の求解専用。スレッド間で共有しないこと。 */
+typedef struct cgnr_recycle cgnr_recycle_t;
+
+__attribute__((visibility("default")))
+cgnr_recycle_t* cgnr_recycle_create(
+    int kmax,                      /* 保持する列数 (例 8)      */
+    int lmax                       /* 1 回の求解で拾う方向数 (例 8) */
+);
+__attribute__((visibility("default")))
+void cgnr_recycle_destroy(cgnr_recycle_t* rec);
+__attribute__((visibility("default")))
+void cgnr_recycle_reset(cgnr_recycle_t* rec);   /* 部分空間を破棄 */
+__attribute__((visibility("default")))
+int  cgnr_recycle_size(const cgnr_recycle_t* rec);
+
+/* 求解統計 (テレメトリ)
+ *   リサイクル付きの求解ごとにハンドルへ累積される。
+ *   通常版を含むすべての求解は呼び出しスレッドごとにも累積される。 */
+typedef struct cgnr_stats {
+    long long solves;          /* 求解回数                          */
+    long long iterations;      /* Krylov 反復の累計                 */
+    long long spmv;            /* 疎行列ベクトル積の累計            */
+    long long allocations;     /* ヒープ確保回数の累計              */
+    long long solve_ns;        /* 求解時間の累計 [ns]               */
+    long long setup_ns;        /*  うち行列生成・部分空間の準備・初期残差 */
+    long long iterate_ns;      /*  うち Krylov 反復                 */
+    long long update_ns;       /*  うち部分空間の更新と後片付け     */
+    int       last_iterations; /* 直近の反復回数 (失敗時は戻り値)   */
+    double    last_residual;   /* 直近の残差ノルム                  */
+} cgnr_stats_t;
+
+__attribute__((visibility("default")))
+void cgnr_recycle_stats(const cgnr_recycle_t* rec, cgnr_stats_t* out);
+__attribute__((visibility("default")))
+void cgnr_recycle_stats_reset(cgnr_recycle_t* rec);
+
+/* 呼び出しスレッドで実行したすべての求解の統計 (ハンドルのない通常版を含む) */
+__attribute__((visibility("default")))
+void cgnr_thread_stats(cgnr_stats_t* out);
+__attribute__((visibility("default")))
+void cgnr_thread_stats_reset(void);
+
+/* 呼び出しスレッドで BLAS が使うスレッド数を設定し、 以前の値を返す。
+ *   逐次版 ArmPL (libarmpl_lp64) をリンクしているので常に 1 を返すだけ。
+ *   並列に多数の求解を流す場合の MKL 版との互換用。 */
+__attribute__((visibility("default")))
+int cgnr_set_blas_threads_local(int nthreads);
+
+/* 求解の監視 (進捗通知と中断)
+ *   progress は every 反復ごとに (反復回数, 元の系の相対残差 ‖b − A x‖/‖b‖) で呼ばれ、
+ *   0 以外を返すと求解を中断する。 cancel は毎反復読まれ、 0 以外なら中断する。
+ *   どちらも NULL 可。 progress はソルバーを呼んだスレッドで呼ばれる。
+ *   中断した求解は -4 を返し (MKL 版と共通)、 x にはその時点の近似解が残る。
+ *   リサイクル付きの求解にだけ効く (rec == NULL の通常版は監視しない)。 */
+typedef int (*cgnr_progress_fn)(int iteration, double residual, void* user);
+
+__attribute__((visibility("default")))
+void cgnr_recycle_set_monitor(cgnr_recycle_t* rec,
+                              cgnr_progress_fn progress, void* user, int every,
+                              const volatile int* cancel);
+
+/* 引数・戻り値は cgnr_solve_lp64 と同じ。 rec == NULL なら通常の CGNR */
+__attribute__((visibility("default")))
+int cgnr_solve_recycle_lp64(
+    int m, int n,
+    const int* rowptr, const int* colind, const double* values,
+    const double* b, double* x,
+    double tol, int maxit,
+    cgnr_recycle_t* rec
+);
+
+/* 引数・戻り値は cg_solve_lp64 と同じ。 rec == NULL なら通常の CG */
+__attribute__((visibility("default")))
+int cg_solve_recycle_lp64(
+    int n,
+    const int* rowptr, const int* colind, const double* vals,
+    const double* b, double* x,
+    double tol, int maxit,
+    cgnr_recycle_t* rec
+);
+
+
 #ifdef __cplusplus
 }
 #endif
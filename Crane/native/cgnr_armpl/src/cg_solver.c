@@ -3,18 +3,21 @@
 #include <string.h>
 #include "armpl.h"
 #include "../include/cgnr_solver.h"
+#include "recycle.h"
 
 /* CSR→ArmPL ハンドル生成は再利用 --------------------------- */
 extern armpl_spmat_t
     create_csr_d(int m,int n,const int*,const int*,const double*);  /* 宣言だけ */
 
-#define NEWVEC(v,n)  do{ (v)=calloc((n),sizeof(double)); if(!(v)) return -1; }while(0)
+#define NEWVEC(v,n)  do{ (v)=counted(&allocs,calloc((n),sizeof(double))); if(!(v)) return -1; }while(0)
 
 int cg_solve_lp64(int n,
                   const int* rowptr, const int* colind, const double* val,
                   const double* b, double* x,
                   double tol, int maxit)
 {
+    solve_clock_t clk = { recycle_now_ns() };
+    long long allocs = 0, spmv = 0;
     armpl_spmat_t A = create_csr_d(n,n,rowptr,colind,val);
     if(!A) return -1;
 
@@ -28,12 +31,15 @@ int cg_solve_lp64(int n,
     cblas_daxpy(n, 1.0, b, 1, r, 1);
 
     double rsold = cblas_ddot(n,r,1,r,1);
+    spmv += 1;
+    clk.iterate = recycle_now_ns();
 
     int k=0;
     for(; k<maxit && sqrt(rsold) > tol; ++k)
     {
         armpl_spmv_exec_d(ARMPL_SPARSE_OPERATION_NOTRANS,
                           1.0,A,p,0.0,Ap);          /* Ap = A p */
+        spmv += 1;
         double alpha = rsold / cblas_ddot(n,p,1,Ap,1);
 
         /* x  = x + α p */
@@ -42,7 +48,7 @@ int cg_solve_lp64(int n,
         cblas_daxpy(n,-alpha,Ap,1, r,1);
 
         double rsnew = cblas_ddot(n,r,1,r,1);
-        if (sqrt(rsnew) <= tol) { ++k; break; }
+        if (sqrt(rsnew) <= tol) { rsold = rsnew; ++k; break; }
 
         double beta = rsnew / rsold;
         for(int i=0;i<n;++i) p[i] = r[i] + beta*p[i];
@@ -50,9 +56,87 @@ int cg_solve_lp64(int n,
         rsold = rsnew;
     }
 
+    clk.update = recycle_now_ns();
     free(r); free(p); free(Ap);
     armpl_spmat_destroy(A);
+    recycle_record(NULL, &clk, k, spmv, allocs, sqrt(rsold));
 
     if (k>=maxit) return -2;
     return k;                  /* 収束回数を返す */
-}
\ No newline at end of file
+}
+
+/* ----- リサイクル付き CG (deflated CG) ------------------------------ */
+int cg_solve_recycle_lp64(int n,
+                          const int* rowptr, const int* colind, const double* val,
+                          const double* b, double* x,
+                          double tol, int maxit,
+                          cgnr_recycle_t* rec)
+{
+    if (!rec) return cg_solve_lp64(n,rowptr,colind,val,b,x,tol,maxit);
+    solve_clock_t clk = { recycle_now_ns() };
+    long long allocs = 0, spmv = 0;
+    if (recycle_prepare(rec, n, 0)) return -1;
+
+    armpl_spmat_t A = create_csr_d(n,n,rowptr,colind,val);
+    if(!A) return -1;
+
+    double *r  = counted(&allocs, calloc(n, sizeof(double)));
+    double *p  = counted(&allocs, calloc(n, sizeof(double)));
+    double *Ap = counted(&allocs, calloc(n, sizeof(double)));
+    if(!r||!p||!Ap){ free(r); free(p); free(Ap); armpl_spmat_destroy(A); return -1; }
+
+    /* MW = A W */
+    for(int j=0;j<rec->k;++j)
+        armpl_spmv_exec_d(ARMPL_SPARSE_OPERATION_NOTRANS,
+                          1.0,A,rec->W+(size_t)j*n,0.0,rec->MW+(size_t)j*n);
+    spmv += rec->k;
+    recycle_factor(rec);
+
+    /* r0 = b - A·x0、 W 成分は粗空間で先に解く */
+    memcpy(r,b,n*sizeof(double));
+    armpl_spmv_exec_d(ARMPL_SPARSE_OPERATION_NOTRANS, -1.0, A, x, 1.0, r);
+    spmv += 1;
+    if (rec->k > 0) {
+        recycle_coarse(rec, r, x);
+        memcpy(r,b,n*sizeof(double));
+        armpl_spmv_exec_d(ARMPL_SPARSE_OPERATION_NOTRANS, -1.0, A, x, 1.0, r);
+        spmv += 1;
+    }
+    recycle_project(rec, r, p, NULL, NULL, 0.0);           /* p0 = r0 - W G⁻¹ MWᵀ r0 */
+
+    double rsold = cblas_ddot(n,r,1,r,1);
+    double bnorm = cblas_dnrm2(n, b, 1);
+    clk.iterate = recycle_now_ns();
+
+    int k=0, cancelled=0;
+    for(; k<maxit && sqrt(rsold) > tol; ++k)
+    {
+        armpl_spmv_exec_d(ARMPL_SPARSE_OPERATION_NOTRANS,
+                          1.0,A,p,0.0,Ap);          /* Ap = A p */
+        spmv += 1;
+        double pAp = cblas_ddot(n,p,1,Ap,1);
+        recycle_harvest(rec, p, NULL, pAp);
+        double alpha = rsold / pAp;
+
+        cblas_daxpy(n, alpha, p,1, x,1);
+        cblas_daxpy(n,-alpha,Ap,1, r,1);
+
+        double rsnew = cblas_ddot(n,r,1,r,1);
+        if (sqrt(rsnew) <= tol) { rsold = rsnew; ++k; break; }
+        if (recycle_poll(rec, k+1, r, n, bnorm)) { rsold = rsnew; ++k; cancelled = 1; break; }
+
+        recycle_project(rec, r, p, NULL, NULL, rsnew/rsold);
+        rsold = rsnew;
+    }
+
+    clk.update = recycle_now_ns();
+    if (!cancelled) recycle_update(rec);
+
+    free(r); free(p); free(Ap);
+    armpl_spmat_destroy(A);
+    recycle_record(rec, &clk, k, spmv, allocs, sqrt(rsold));
+
+    if (cancelled) return -4;
+    if (k>=maxit) return -2;
+    return k;
+}
@@ -3,10 +3,11 @@
 #include <string.h>
 #include "armpl.h"
 #include "../include/cgnr_solver.h"
+#include "recycle.h"
 
-/* 内部ワーク確保 */
+/* 内部ワーク確保 (確保回数を allocs に数える) */
 #define NEWVEC(ptr, n)               \
-    do { (ptr) = calloc((n), sizeof(double)); if(!(ptr)) return -1; } while(0)
+    do { (ptr) = counted(&allocs, calloc((n), sizeof(double))); if(!(ptr)) return -1; } while(0)
 
 /* ArmPL スパース行列の生成 */
 armpl_spmat_t
@@ -32,6 +33,8 @@ int cgnr_solve_lp64(int m, int n,
                     const double* b, double* x,
                     double tol, int maxit)
 {
+    solve_clock_t clk = { recycle_now_ns() };
+    long long allocs = 0, spmv = 0;
     armpl_spmat_t A = create_csr_d(m,n,rowptr,colind,val);
     if (!A) return -1;
 
@@ -49,11 +52,14 @@ int cgnr_solve_lp64(int m, int n,
     /* p0 = Aᵀ r0 */
     armpl_spmv_exec_d(ARMPL_SPARSE_OPERATION_TRANS, 1.0, A, r, 0.0, p);
     double rho = cblas_ddot(n,p,1,p,1);
+    spmv += 2;
+    clk.iterate = recycle_now_ns();
 
     int iter = 0;
     for (; iter < maxit && sqrt(rho) > tol; ++iter)
     {
         /* q = A p  */
+        spmv += 2;
         armpl_spmv_exec_d(ARMPL_SPARSE_OPERATION_NOTRANS, 1.0, A, p, 0.0, q);
         double denom = cblas_ddot(m,q,1,q,1);
         if (denom == 0.0) { iter = -3; break; }
@@ -65,7 +71,7 @@ int cgnr_solve_lp64(int m, int n,
         armpl_spmv_exec_d(ARMPL_SPARSE_OPERATION_TRANS, 1.0, A, r, 0.0, At);
         double rho_new = cblas_ddot(n, At,1, At,1);
 
-        if (sqrt(rho_new) <= tol) { ++iter; break; }
+        if (sqrt(rho_new) <= tol) { rho = rho_new; ++iter; break; }
 
         double beta = rho_new / rho;
         for(int i=0;i<n;++i) p[i] = At[i] + beta * p[i];
@@ -73,11 +79,115 @@ int cgnr_solve_lp64(int m, int n,
     }
 
     /* 後片付け */
+    clk.update = recycle_now_ns();
     free(r); free(p); free(q); free(At);
     armpl_spmat_destroy(A);
+    recycle_record(NULL, &clk, iter, spmv, allocs, sqrt(rho));
 
     if (iter >= maxit) return -2;    /* 収束せず */
     if (iter < 0)       return -3;   /* API 失敗 */
     return iter;                     /* 収束回数 */
 }
 
+/* ----- リサイクル付き CGNR (deflated CGNR) -------------------------- *
+ *   M = AᵀA に対して W 方向をデフレーションした CG を正規方程式に適用する。
+ *   x は初期値として使う。                                              */
+int cgnr_solve_recycle_lp64(int m, int n,
+                            const int* rowptr, const int* colind, const double* val,
+                            const double* b, double* x,
+                            double tol, int maxit,
+                            cgnr_recycle_t* rec)
+{
+    if (!rec) return cgnr_solve_lp64(m,n,rowptr,colind,val,b,x,tol,maxit);
+    solve_clock_t clk = { recycle_now_ns() };
+    long long allocs = 0, spmv = 0;
+    if (recycle_prepare(rec, n, m)) return -1;
+
+    armpl_spmat_t A = create_csr_d(m,n,rowptr,colind,val);
+    if (!A) return -1;
+
+    double *r  = counted(&allocs, calloc(m, sizeof(double)));
+    double *z  = counted(&allocs, calloc(n, sizeof(double)));
+    double *p  = counted(&allocs, calloc(n, sizeof(double)));
+    double *pm = counted(&allocs, calloc(m, sizeof(double)));
+    double *q  = counted(&allocs, calloc(m, sizeof(double)));
+    if (!r||!z||!p||!pm||!q) {
+        free(r); free(z); free(p); free(pm); free(q);
+        armpl_spmat_destroy(A);
+        return -1;
+    }
+
+    /* A が変わると前回の W は null(A) 成分を含みうる。 粗空間補正がそれを x に
+     * 持ち込むと最小ノルム解から外れるので、 影から W = Aᵀ Wm を作り直して
+     * range(Aᵀ) に戻す (AᵀA を掛ける冪乗法と違い、 小さい固有値の方向を保つ)。 */
+    if (rec->k > 0) {
+        for (int j = 0; j < rec->k; ++j)
+            armpl_spmv_exec_d(ARMPL_SPARSE_OPERATION_TRANS, 1.0, A, rec->Wm+(size_t)j*m, 0.0, rec->W+(size_t)j*n);
+        spmv += rec->k;
+        recycle_range(rec);
+    }
+
+    /* MW = Aᵀ(A W) を現在の A で作り直す */
+    for (int j = 0; j < rec->k; ++j) {
+        armpl_spmv_exec_d(ARMPL_SPARSE_OPERATION_NOTRANS, 1.0, A, rec->W+(size_t)j*n, 0.0, q);
+        armpl_spmv_exec_d(ARMPL_SPARSE_OPERATION_TRANS,   1.0, A, q, 0.0, rec->MW+(size_t)j*n);
+    }
+    spmv += 2*rec->k;
+    recycle_factor(rec);
+
+    /* r0 = b - A·x0,  z0 = Aᵀ r0 */
+    memcpy(r, b, m*sizeof(double));
+    armpl_spmv_exec_d(ARMPL_SPARSE_OPERATION_NOTRANS, -1.0, A, x, 1.0, r);
+    armpl_spmv_exec_d(ARMPL_SPARSE_OPERATION_TRANS, 1.0, A, r, 0.0, z);
+    spmv += 2;
+
+    /* 粗空間補正 x0 += W G⁻¹ Wᵀ z0 */
+    if (rec->k > 0) {
+        recycle_coarse(rec, z, x);
+        memcpy(r, b, m*sizeof(double));
+        armpl_spmv_exec_d(ARMPL_SPARSE_OPERATION_NOTRANS, -1.0, A, x, 1.0, r);
+        armpl_spmv_exec_d(ARMPL_SPARSE_OPERATION_TRANS, 1.0, A, r, 0.0, z);
+        spmv += 2;
+    }
+
+    /* p0 = z0 - W G⁻¹ MWᵀ z0  (影は pm0 = r0 - Wm G⁻¹ MWᵀ z0) */
+    recycle_project(rec, z, p, r, pm, 0.0);
+    double rho = cblas_ddot(n,z,1,z,1);
+    double bnorm = cblas_dnrm2(m, b, 1);
+    clk.iterate = recycle_now_ns();
+
+    int iter = 0, cancelled = 0;
+    for (; iter < maxit && sqrt(rho) > tol; ++iter)
+    {
+        armpl_spmv_exec_d(ARMPL_SPARSE_OPERATION_NOTRANS, 1.0, A, p, 0.0, q);
+        double denom = cblas_ddot(m,q,1,q,1);
+        if (denom == 0.0) { iter = -3; break; }
+        recycle_harvest(rec, p, pm, denom);
+
+        double alpha = rho / denom;
+        cblas_daxpy(n,  alpha, p,1, x,1);     /* x += α p */
+        cblas_daxpy(m, -alpha, q,1, r,1);     /* r -= α q */
+
+        armpl_spmv_exec_d(ARMPL_SPARSE_OPERATION_TRANS, 1.0, A, r, 0.0, z);
+        double rho_new = cblas_ddot(n, z,1, z,1);
+        spmv += 2;
+
+        if (sqrt(rho_new) <= tol) { rho = rho_new; ++iter; break; }
+        if (recycle_poll(rec, iter + 1, r, m, bnorm)) { rho = rho_new; ++iter; cancelled = 1; break; }
+
+        recycle_project(rec, z, p, r, pm, rho_new / rho);
+        rho = rho_new;
+    }
+
+    clk.update = recycle_now_ns();
+    if (iter >= 0 && !cancelled) recycle_update(rec);
+
+    free(r); free(z); free(p); free(pm); free(q);
+    armpl_spmat_destroy(A);
+    recycle_record(rec, &clk, iter, spmv, allocs, sqrt(rho));
+
+    if (cancelled)      return -4;
+    if (iter >= maxit) return -2;
+    if (iter < 0)       return -3;
+    return iter;
+}
@@ -0,0 +1,514 @@
+#define _POSIX_C_SOURCE 200809L     /* clock_gettime */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "armpl.h"
+#include "recycle.h"
+
+#define KMAX_LIMIT 32
+#define LMAX_LIMIT 64
+#define CHOL_EPS   1e-12
+#define RANGE_EPS  1e-10    /* recycle_range で捨てる列の閾値 (作り直す前の列は単位長) */
+
+/* ---- 公開 API: ハンドル管理 ------------------------------------ */
+cgnr_recycle_t* cgnr_recycle_create(int kmax, int lmax)
+{
+    if (kmax < 1) kmax = 1;
+    if (kmax > KMAX_LIMIT) kmax = KMAX_LIMIT;
+    if (lmax < 1) lmax = 1;
+    if (lmax > LMAX_LIMIT) lmax = LMAX_LIMIT;
+
+    cgnr_recycle_t* rec = calloc(1, sizeof(cgnr_recycle_t));
+    if (!rec) return NULL;
+    rec->kmax = kmax;
+    rec->lmax = lmax;
+    return rec;
+}
+
+static void release_buffers(cgnr_recycle_t* rec)
+{
+    free(rec->W); free(rec->MW); free(rec->U); free(rec->S); free(rec->P);
+    free(rec->Wm); free(rec->Um); free(rec->Sm); free(rec->Pm);
+    free(rec->theta); free(rec->d); free(rec->L); free(rec->y);
+    rec->W = rec->MW = rec->U = rec->S = rec->P = NULL;
+    rec->Wm = rec->Um = rec->Sm = rec->Pm = NULL;
+    rec->theta = rec->d = rec->L = rec->y = NULL;
+    rec->n = rec->m = rec->k = rec->ku = rec->l = 0;
+}
+
+void cgnr_recycle_destroy(cgnr_recycle_t* rec)
+{
+    if (!rec) return;
+    release_buffers(rec);
+    free(rec);
+}
+
+void cgnr_recycle_reset(cgnr_recycle_t* rec)
+{
+    if (!rec) return;
+    rec->k = rec->ku = rec->l = 0;
+}
+
+int cgnr_recycle_size(const cgnr_recycle_t* rec)
+{
+    return rec ? rec->k : 0;
+}
+
+void cgnr_recycle_stats(const cgnr_recycle_t* rec, cgnr_stats_t* out)
+{
+    if (!out) return;
+    if (rec) *out = rec->stats;
+    else     memset(out, 0, sizeof(*out));
+}
+
+void cgnr_recycle_stats_reset(cgnr_recycle_t* rec)
+{
+    if (rec) memset(&rec->stats, 0, sizeof(rec->stats));
+}
+
+void cgnr_recycle_set_monitor(cgnr_recycle_t* rec,
+                              cgnr_progress_fn progress, void* user, int every,
+                              const volatile int* cancel)
+{
+    if (!rec) return;
+    rec->progress = progress;
+    rec->user     = user;
+    rec->every    = every;
+    rec->cancel   = cancel;
+}
+
+int cgnr_set_blas_threads_local(int nthreads)
+{
+    (void)nthreads;
+    return 1;
+}
+
+/* ---- 内部: 統計 ------------------------------------------------- */
+static _Thread_local cgnr_stats_t thread_stats;
+
+void cgnr_thread_stats(cgnr_stats_t* out)
+{
+    if (out) *out = thread_stats;
+}
+
+void cgnr_thread_stats_reset(void)
+{
+    memset(&thread_stats, 0, sizeof(thread_stats));
+}
+
+long long recycle_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* ---- 内部: 監視 ------------------------------------------------- */
+int recycle_poll(cgnr_recycle_t* rec, int iter, const double* r, int len, double bnorm)
+{
+    if (rec->cancel && *rec->cancel) return 1;
+    if (rec->progress && rec->every > 0 && iter % rec->every == 0) {
+        double residual = cblas_dnrm2(len, r, 1);
+        if (bnorm > 0.0) residual /= bnorm;
+        return rec->progress(iter, residual, rec->user) != 0;
+    }
+    return 0;
+}
+
+static void add_stats(cgnr_stats_t* st, const solve_clock_t* clk, long long end,
+                      int iter, long long spmv, long long allocations, double residual)
+{
+    st->solves      += 1;
+    st->iterations  += iter > 0 ? iter : 0;
+    st->spmv        += spmv;
+    st->allocations += allocations;
+    st->solve_ns    += end - clk->t0;
+    st->setup_ns    += clk->iterate - clk->t0;
+    st->iterate_ns  += clk->update - clk->iterate;
+    st->update_ns   += end - clk->update;
+    st->last_iterations = iter;
+    st->last_residual   = residual;
+}
+
+void recycle_record(cgnr_recycle_t* rec, const solve_clock_t* clk, int iter,
+                    long long spmv, long long allocations, double residual)
+{
+    long long end = recycle_now_ns();
+    if (rec) {
+        allocations += rec->allocs;
+        rec->allocs = 0;
+        add_stats(&rec->stats, clk, end, iter, spmv, allocations, residual);
+    }
+    add_stats(&thread_stats, clk, end, iter, spmv, allocations, residual);
+}
+
+/* ---- 内部: 確保 ------------------------------------------------- */
+int recycle_prepare(cgnr_recycle_t* rec, int n, int m)
+{
+    rec->ku = rec->l = rec->allocs = 0;
+    if (rec->n == n && rec->m == m) return 0;
+
+    release_buffers(rec);
+    size_t kn = (size_t)n * rec->kmax, ln = (size_t)n * rec->lmax;
+    size_t km = (size_t)m * rec->kmax, lm = (size_t)m * rec->lmax;
+    long long* c = &rec->allocs;
+    rec->W     = counted(c, calloc(kn, sizeof(double)));
+    rec->MW    = counted(c, calloc(kn, sizeof(double)));
+    rec->U     = counted(c, calloc(kn, sizeof(double)));
+    rec->S     = counted(c, calloc(kn, sizeof(double)));
+    rec->P     = counted(c, calloc(ln, sizeof(double)));
+    rec->theta = counted(c, calloc(rec->kmax, sizeof(double)));
+    rec->d     = counted(c, calloc(rec->lmax, sizeof(double)));
+    rec->L     = counted(c, calloc((size_t)rec->kmax * rec->kmax, sizeof(double)));
+    rec->y     = counted(c, calloc(rec->kmax, sizeof(double)));
+    if (!rec->W || !rec->MW || !rec->U || !rec->S || !rec->P ||
+        !rec->theta || !rec->d || !rec->L || !rec->y) {
+        release_buffers(rec);
+        return -1;
+    }
+    if (m > 0) {
+        rec->Wm = counted(c, calloc(km, sizeof(double)));
+        rec->Um = counted(c, calloc(km, sizeof(double)));
+        rec->Sm = counted(c, calloc(km, sizeof(double)));
+        rec->Pm = counted(c, calloc(lm, sizeof(double)));
+        if (!rec->Wm || !rec->Um || !rec->Sm || !rec->Pm) {
+            release_buffers(rec);
+            return -1;
+        }
+    }
+    rec->n = n;
+    rec->m = m;
+    return 0;
+}
+
+/* ---- 内部: 小さい密行列 (対称行列以外は行優先, 主次元 ld) ----- */
+
+/* 下三角 Cholesky。 対角が eps·max(diag) 以下になった位置で打ち切り、
+ * 有効なサイズを返す (先頭の主小行列の分解はそのまま有効)。 */
+static int chol_truncate(double* a, int s, int ld)
+{
+    double dmax = 0.0;
+    for (int i = 0; i < s; ++i)
+        if (a[i*ld+i] > dmax) dmax = a[i*ld+i];
+    if (!(dmax > 0.0)) return 0;
+
+    for (int j = 0; j < s; ++j) {
+        double djj = a[j*ld+j];
+        for (int p = 0; p < j; ++p) djj -= a[j*ld+p]*a[j*ld+p];
+        if (!(djj > CHOL_EPS*dmax)) return j;
+        djj = sqrt(djj);
+        a[j*ld+j] = djj;
+        for (int i = j+1; i < s; ++i) {
+            double v = a[i*ld+j];
+            for (int p = 0; p < j; ++p) v -= a[i*ld+p]*a[j*ld+p];
+            a[i*ld+j] = v / djj;
+        }
+    }
+    return s;
+}
+
+/* L z = y  (前進代入, in place) */
+static void lower_solve(const double* L, int s, int ld, double* y)
+{
+    for (int i = 0; i < s; ++i) {
+        double v = y[i];
+        for (int p = 0; p < i; ++p) v -= L[i*ld+p]*y[p];
+        y[i] = v / L[i*ld+i];
+    }
+}
+
+/* Lᵀ z = y  (後退代入, in place) */
+static void upper_solve(const double* L, int s, int ld, double* y)
+{
+    for (int i = s-1; i >= 0; --i) {
+        double v = y[i];
+        for (int p = i+1; p < s; ++p) v -= L[p*ld+i]*y[p];
+        y[i] = v / L[i*ld+i];
+    }
+}
+
+/* 巡回 Jacobi 法による対称行列の固有分解。 a は破壊され対角に固有値が残る。
+ * v の列が固有ベクトル。 */
+static void jacobi_eig(double* a, double* v, int s)
+{
+    for (int i = 0; i < s; ++i)
+        for (int j = 0; j < s; ++j) v[i*s+j] = (i == j) ? 1.0 : 0.0;
+
+    for (int sweep = 0; sweep < 50; ++sweep) {
+        double off = 0.0, diag = 0.0;
+        for (int i = 0; i < s; ++i) {
+            diag += a[i*s+i]*a[i*s+i];
+            for (int j = i+1; j < s; ++j) off += a[i*s+j]*a[i*s+j];
+        }
+        if (off <= 1e-30*diag || off == 0.0) break;
+
+        for (int p = 0; p < s; ++p)
+            for (int q = p+1; q < s; ++q) {
+                double apq = a[p*s+q];
+                if (apq == 0.0) continue;
+                double tau = (a[q*s+q] - a[p*s+p]) / (2.0*apq);
+                double t = (tau >= 0 ? 1.0 : -1.0) / (fabs(tau) + sqrt(1.0 + tau*tau));
+                double c = 1.0 / sqrt(1.0 + t*t), sn = t*c;
+
+                for (int r = 0; r < s; ++r) {         /* 列 p,q を回転 */
+                    double arp = a[r*s+p], arq = a[r*s+q];
+                    a[r*s+p] = c*arp - sn*arq;
+                    a[r*s+q] = sn*arp + c*arq;
+                }
+                for (int r = 0; r < s; ++r) {         /* 行 p,q を回転 */
+                    double apr = a[p*s+r], aqr = a[q*s+r];
+                    a[p*s+r] = c*apr - sn*aqr;
+                    a[q*s+r] = sn*apr + c*aqr;
+                }
+                for (int r = 0; r < s; ++r) {
+                    double vrp = v[r*s+p], vrq = v[r*s+q];
+                    v[r*s+p] = c*vrp - sn*vrq;
+                    v[r*s+q] = sn*vrp + c*vrq;
+                }
+            }
+    }
+}
+
+/* ---- 内部: Rayleigh–Ritz -------------------------------------- */
+
+/* n×cnt 列優先の列ブロックと、 その m×cnt の影 (NULL 可) */
+typedef struct { const double* v; const double* vm; int cnt; } block_t;
+
+/* F の (r0,c0) ブロックに Aᵀ B を書き、 対称位置へ写す。
+ * 対角ブロックは (X + Xᵀ)/2 に対称化する。 */
+static void gram_block(int n, const double* A, int ka, const double* B, int kb,
+                       double* F, int s, int r0, int c0)
+{
+    if (ka == 0 || kb == 0) return;
+    cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, ka, kb, n,
+                1.0, A, n, B, n, 0.0, F + r0 + (size_t)c0*s, s);
+    for (int j = 0; j < kb; ++j)
+        for (int i = 0; i < ka; ++i) {
+            double* a = F + (r0+i) + (size_t)(c0+j)*s;
+            double* b = F + (c0+j) + (size_t)(r0+i)*s;
+            if (r0 != c0)      *b = *a;
+            else if (i < j)    *a = *b = 0.5*(*a + *b);
+        }
+}
+
+/* Z = [z_0, z_1, ...] (列数 s) 上で F y = θ B y を解き、 θ の小さい順に
+ * kout 本の Ritz ベクトル (正規化済み) を out (n×kout) に書く。
+ * m > 0 なら同じ係数で影 outm (m×kout) も書く。
+ * F, B (s×s 対称) は破壊される。 out, outm は Z と重なってはならない。
+ * 確保回数を *allocs に加える。 書いた本数を返す (0 = 失敗)。 */
+static int rayleigh_ritz(int n, int m, const block_t* z, int nz, int s,
+                         double* F, double* B, int kout,
+                         double* out, double* outm, double* theta, long long* allocs)
+{
+    int t = chol_truncate(B, s, s);          /* B = L Lᵀ、 従属な列は捨てる */
+    if (t == 0) return 0;
+    if (kout > t) kout = t;
+
+    double *C   = counted(allocs, malloc((size_t)t*t*sizeof(double)));
+    double *V   = counted(allocs, malloc((size_t)t*t*sizeof(double)));
+    double *col = counted(allocs, malloc((size_t)t*sizeof(double)));
+    double *Y   = counted(allocs, calloc((size_t)s*kout, sizeof(double)));
+    int    *ord = counted(allocs, malloc((size_t)t*sizeof(int)));
+    if (!C || !V || !col || !Y || !ord) {
+        free(C); free(V); free(col); free(Y); free(ord);
+        return 0;
+    }
+
+    /* C = L⁻¹ F L⁻ᵀ  (先頭 t×t) */
+    for (int j = 0; j < t; ++j) {
+        for (int i = 0; i < t; ++i) col[i] = F[i*s+j];
+        lower_solve(B, t, s, col);
+        for (int i = 0; i < t; ++i) C[i*t+j] = col[i];
+    }
+    for (int i = 0; i < t; ++i) {
+        lower_solve(B, t, s, C + (size_t)i*t);
+    }
+    for (int i = 0; i < t; ++i)
+        for (int j = 0; j < i; ++j)
+            C[i*t+j] = C[j*t+i] = 0.5*(C[i*t+j] + C[j*t+i]);
+    jacobi_eig(C, V, t);
+
+    for (int i = 0; i < t; ++i) ord[i] = i;
+    for (int i = 1; i < t; ++i) {
+        int o = ord[i], j = i;
+        while (j > 0 && C[ord[j-1]*t+ord[j-1]] > C[o*t+o]) { ord[j] = ord[j-1]; --j; }
+        ord[j] = o;
+    }
+
+    /* Y = L⁻ᵀ V (s×kout 列優先、 t 行目以降は 0) */
+    for (int c = 0; c < kout; ++c) {
+        for (int i = 0; i < t; ++i) col[i] = V[i*t+ord[c]];
+        upper_solve(B, t, s, col);
+        memcpy(Y + (size_t)c*s, col, (size_t)t*sizeof(double));
+        theta[c] = C[ord[c]*t+ord[c]];
+    }
+
+    /* out = Z Y,  outm = Zm Y */
+    double beta = 0.0;
+    for (int g = 0, off = 0; g < nz; off += z[g].cnt, ++g) {
+        int cnt = t - off < z[g].cnt ? t - off : z[g].cnt;
+        if (cnt <= 0) continue;
+        cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, n, kout, cnt,
+                    1.0, z[g].v, n, Y + off, s, beta, out, n);
+        if (m > 0)
+            cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, m, kout, cnt,
+                        1.0, z[g].vm, m, Y + off, s, beta, outm, m);
+        beta = 1.0;
+    }
+    for (int c = 0; c < kout; ++c) {
+        double nrm = cblas_dnrm2(n, out + (size_t)c*n, 1);
+        if (!(nrm > 0.0)) continue;
+        cblas_dscal(n, 1.0/nrm, out + (size_t)c*n, 1);
+        if (m > 0) cblas_dscal(m, 1.0/nrm, outm + (size_t)c*m, 1);
+    }
+
+    free(C); free(V); free(col); free(Y); free(ord);
+    return kout;
+}
+
+/* 溜まった探索方向 P を候補 U に圧縮 */
+static void compress(cgnr_recycle_t* rec)
+{
+    int n = rec->n, ku = rec->ku, l = rec->l, s = ku + l;
+    rec->l = 0;
+
+    double *F = counted(&rec->allocs, calloc((size_t)s*s, sizeof(double)));
+    double *B = counted(&rec->allocs, calloc((size_t)s*s, sizeof(double)));
+    if (!F || !B) { free(F); free(B); return; }
+
+    /* U は Ritz ベクトル、 P は M 共役なので ZᵀMZ は対角 */
+    for (int i = 0; i < ku; ++i) F[i*s+i] = rec->theta[i];
+    for (int i = 0; i < l; ++i)  F[(ku+i)*s+ku+i] = rec->d[i];
+    gram_block(n, rec->U, ku, rec->U, ku, B, s, 0,  0);
+    gram_block(n, rec->U, ku, rec->P, l,  B, s, 0,  ku);
+    gram_block(n, rec->P, l,  rec->P, l,  B, s, ku, ku);
+
+    block_t z[2] = { { rec->U, rec->Um, ku }, { rec->P, rec->Pm, l } };
+    int got = rayleigh_ritz(n, rec->m, z, 2, s, F, B, rec->kmax,
+                            rec->S, rec->Sm, rec->theta, &rec->allocs);
+    if (got > 0) {
+        double* tmp = rec->U; rec->U = rec->S; rec->S = tmp;
+        tmp = rec->Um; rec->Um = rec->Sm; rec->Sm = tmp;
+        rec->ku = got;
+    }
+    free(F); free(B);
+}
+
+/* ---- 内部: 求解中の操作 ---------------------------------------- */
+void recycle_range(cgnr_recycle_t* rec)
+{
+    int n = rec->n, m = rec->m, k = 0;
+    for (int j = 0; j < rec->k; ++j) {
+        double* w = rec->W + (size_t)j*n;
+        double nrm = cblas_dnrm2(n, w, 1);
+        if (!(nrm > RANGE_EPS)) continue;
+        if (k != j) {
+            memcpy(rec->W  + (size_t)k*n, w, (size_t)n*sizeof(double));
+            memcpy(rec->Wm + (size_t)k*m, rec->Wm + (size_t)j*m, (size_t)m*sizeof(double));
+        }
+        cblas_dscal(n, 1.0/nrm, rec->W  + (size_t)k*n, 1);
+        cblas_dscal(m, 1.0/nrm, rec->Wm + (size_t)k*m, 1);
+        ++k;
+    }
+    rec->k = k;
+}
+
+void recycle_factor(cgnr_recycle_t* rec)
+{
+    int n = rec->n, k = rec->k, ld = rec->kmax;
+    for (int i = 0; i < k; ++i)
+        for (int j = 0; j <= i; ++j) {
+            double g = 0.5*(cblas_ddot(n, rec->W+(size_t)i*n,1, rec->MW+(size_t)j*n,1)
+                          + cblas_ddot(n, rec->W+(size_t)j*n,1, rec->MW+(size_t)i*n,1));
+            rec->L[i*ld+j] = rec->L[j*ld+i] = g;
+        }
+    rec->k = chol_truncate(rec->L, k, ld);
+}
+
+void recycle_coarse(cgnr_recycle_t* rec, const double* v, double* x)
+{
+    int n = rec->n, k = rec->k;
+    if (k == 0) return;
+    for (int i = 0; i < k; ++i)
+        rec->y[i] = cblas_ddot(n, rec->W+(size_t)i*n,1, v,1);
+    lower_solve(rec->L, k, rec->kmax, rec->y);
+    upper_solve(rec->L, k, rec->kmax, rec->y);
+    for (int i = 0; i < k; ++i)
+        cblas_daxpy(n, rec->y[i], rec->W+(size_t)i*n,1, x,1);
+}
+
+void recycle_project(cgnr_recycle_t* rec, const double* z, double* p,
+                     const double* zm, double* pm, double beta)
+{
+    int n = rec->n, m = pm ? rec->m : 0, k = rec->k;
+    cblas_dscal(n, beta, p, 1);
+    cblas_daxpy(n, 1.0, z, 1, p, 1);
+    if (m > 0) {
+        cblas_dscal(m, beta, pm, 1);
+        cblas_daxpy(m, 1.0, zm, 1, pm, 1);
+    }
+    if (k == 0) return;
+    for (int i = 0; i < k; ++i)
+        rec->y[i] = cblas_ddot(n, rec->MW+(size_t)i*n,1, z,1);
+    lower_solve(rec->L, k, rec->kmax, rec->y);
+    upper_solve(rec->L, k, rec->kmax, rec->y);
+    for (int i = 0; i < k; ++i) {
+        cblas_daxpy(n, -rec->y[i], rec->W+(size_t)i*n,1, p,1);
+        if (m > 0) cblas_daxpy(m, -rec->y[i], rec->Wm+(size_t)i*m,1, pm,1);
+    }
+}
+
+void recycle_harvest(cgnr_recycle_t* rec, const double* p, const double* pm, double pMp)
+{
+    int n = rec->n, m = rec->m;
+    double nrm = cblas_dnrm2(n, p, 1);
+    if (!(nrm > 0.0) || !(pMp > 0.0)) return;
+
+    double* dst = rec->P + (size_t)rec->l*n;
+    memcpy(dst, p, (size_t)n*sizeof(double));
+    cblas_dscal(n, 1.0/nrm, dst, 1);
+    if (m > 0) {
+        double* dstm = rec->Pm + (size_t)rec->l*m;
+        memcpy(dstm, pm, (size_t)m*sizeof(double));
+        cblas_dscal(m, 1.0/nrm, dstm, 1);
+    }
+    rec->d[rec->l++] = pMp / (nrm*nrm);
+    if (rec->l == rec->lmax) compress(rec);
+}
+
+void recycle_update(cgnr_recycle_t* rec)
+{
+    int n = rec->n, k = rec->k, ku = rec->ku, l = rec->l, s = k + ku + l;
+    rec->ku = rec->l = 0;
+    if (s == 0) return;
+
+    double *F = counted(&rec->allocs, calloc((size_t)s*s, sizeof(double)));
+    double *B = counted(&rec->allocs, calloc((size_t)s*s, sizeof(double)));
+    if (!F || !B) { free(F); free(B); return; }
+
+    int u0 = k, p0 = k + ku;
+    gram_block(n, rec->W,  k, rec->MW, k,  F, s, 0, 0);
+    gram_block(n, rec->MW, k, rec->U,  ku, F, s, 0, u0);
+    gram_block(n, rec->MW, k, rec->P,  l,  F, s, 0, p0);
+    for (int i = 0; i < ku; ++i) F[(u0+i)*s+u0+i] = rec->theta[i];
+    for (int i = 0; i < l; ++i)  F[(p0+i)*s+p0+i] = rec->d[i];
+
+    gram_block(n, rec->W, k,  rec->W, k,  B, s, 0,  0);
+    gram_block(n, rec->W, k,  rec->U, ku, B, s, 0,  u0);
+    gram_block(n, rec->W, k,  rec->P, l,  B, s, 0,  p0);
+    gram_block(n, rec->U, ku, rec->U, ku, B, s, u0, u0);
+    gram_block(n, rec->U, ku, rec->P, l,  B, s, u0, p0);
+    gram_block(n, rec->P, l,  rec->P, l,  B, s, p0, p0);
+
+    /* 新しい W は MW の領域に組み立てる (MW は次回作り直す)。 影は Sm に */
+    block_t z[3] = { { rec->W, rec->Wm, k }, { rec->U, rec->Um, ku }, { rec->P, rec->Pm, l } };
+    int got = rayleigh_ritz(n, rec->m, z, 3, s, F, B, rec->kmax,
+                            rec->MW, rec->Sm, rec->theta, &rec->allocs);
+    if (got > 0) {
+        double* tmp = rec->W; rec->W = rec->MW; rec->MW = tmp;
+        tmp = rec->Wm; rec->Wm = rec->Sm; rec->Sm = tmp;
+        rec->k = got;
+    }
+    free(F); free(B);
+}
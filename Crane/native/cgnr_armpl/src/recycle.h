@@ -0,0 +1,106 @@
+#ifndef CGNR_RECYCLE_H_
+#define CGNR_RECYCLE_H_
+
+#include "../include/cgnr_solver.h"
+
+/* ───────────────────────────────────────────────────────── *
+ *  Krylov 部分空間リサイクル (内部用)
+ *
+ *  M を CG では A、CGNR では AᵀA とする。
+ *  W (n×k) は前回までの求解で得た M の小さい固有値に対応する
+ *  近似固有ベクトル (メカニズム方向) 。求解ごとに
+ *    1. MW と G = WᵀMW を現在の A で作り直す        (recycle_factor)
+ *    2. x0 と探索方向から W 成分を取り除く         (recycle_coarse / recycle_project)
+ *    3. 探索方向を lmax 本ずつ拾い、 その都度
+ *       span[U, P] 上の Rayleigh–Ritz で候補 U に圧縮 (recycle_harvest)
+ *    4. span[W, U, P] 上の Rayleigh–Ritz で W を更新  (recycle_update)
+ *  P は互いに M 共役かつ W と M 直交なので、 ZᵀMZ はブロック対角に近く
+ *  SpMV を追加せずに組み立てられる。
+ *
+ *  CGNR では W, U, P の各列に w = Aᵀ·s となる長さ m の影 s を持たせる
+ *  (探索方向 p = Aᵀ r + βp − W y に対して s = r + βs − Wm y)。
+ *  A が変わったら W を Aᵀ·Wm で作り直すので、 W は常に現在の range(Aᵀ) に入り、
+ *  粗空間補正が null(A) 成分を x に持ち込まない。 A が同じなら W は変わらない。
+ * ───────────────────────────────────────────────────────── */
+struct cgnr_recycle {
+    int     kmax;   /* 保持する列数の上限                 */
+    int     lmax;   /* 圧縮までに溜める探索方向数         */
+    int     n;      /* 確保済みベクトル長 (0 = 未確保)    */
+    int     m;      /* 影の長さ (CGNR の行数, CG では 0)  */
+    int     k;      /* 有効な W の列数                    */
+    int     ku;     /* 有効な U の列数                    */
+    int     l;      /* 溜まっている探索方向数             */
+    double* W;      /* n×kmax  列優先                     */
+    double* MW;     /* n×kmax  M·W                        */
+    double* U;      /* n×kmax  今回の求解での Ritz 候補   */
+    double* S;      /* n×kmax  作業用                     */
+    double* P;      /* n×lmax  探索方向 (正規化済み)      */
+    double* Wm;     /* m×kmax  W = Aᵀ Wm                  */
+    double* Um;     /* m×kmax  U = Aᵀ Um                  */
+    double* Sm;     /* m×kmax  作業用                     */
+    double* Pm;     /* m×lmax  P = Aᵀ Pm                  */
+    double* theta;  /* kmax    U の Ritz 値               */
+    double* d;      /* lmax    pᵀMp                       */
+    double* L;      /* kmax×kmax  G の Cholesky 因子 (下三角) */
+    double* y;      /* kmax    作業用                     */
+    long long allocs;    /* 今回の求解でのヒープ確保回数 */
+    cgnr_stats_t stats;  /* 求解統計                       */
+    cgnr_progress_fn progress;     /* 進捗通知 (NULL 可)    */
+    void*            user;         /* progress に渡す値     */
+    int              every;        /* 通知間隔 [反復]       */
+    const volatile int* cancel;    /* 中断フラグ (NULL 可)  */
+};
+
+/* 長さ n (影は長さ m, CG では 0) 用にバッファを確保。
+ * n か m が変わった場合は W を捨てる。 0 / -1 */
+int  recycle_prepare(cgnr_recycle_t* rec, int n, int m);
+
+/* CGNR 用。 W の先頭 k 列に現在の A で Aᵀ·Wm を入れてから呼ぶ。
+ * W と Wm を同じ係数で正規化し、 ほぼ 0 になった列 (影が null(Aᵀ) に入った列) は捨てる。 */
+void recycle_range(cgnr_recycle_t* rec);
+
+/* MW を埋めた後に呼ぶ。G = WᵀMW を Cholesky 分解し、
+ * 数値的に従属な列以降は切り捨てる。 */
+void recycle_factor(cgnr_recycle_t* rec);
+
+/* y = G⁻¹ Wᵀ v,  x += W y  (初期値の粗空間補正) */
+void recycle_coarse(cgnr_recycle_t* rec, const double* v, double* x);
+
+/* p = beta·p + z − W G⁻¹ MWᵀ z
+ * CGNR では影も pm = beta·pm + zm − Wm G⁻¹ MWᵀ z (z = Aᵀ zm) と更新する。 CG では NULL */
+void recycle_project(cgnr_recycle_t* rec, const double* z, double* p,
+                     const double* zm, double* pm, double beta);
+
+/* 探索方向 p (CGNR では影 pm も) とその pᵀMp を記録 */
+void recycle_harvest(cgnr_recycle_t* rec, const double* p, const double* pm, double pMp);
+
+/* span[W, U, P] 上の Rayleigh–Ritz で W を更新 */
+void recycle_update(cgnr_recycle_t* rec);
+
+/* 単調増加クロック [ns] */
+long long recycle_now_ns(void);
+
+/* 確保に成功していれば *count を 1 増やす。 確保した値をそのまま返す */
+static inline void* counted(long long* count, void* p)
+{
+    if (p) ++*count;
+    return p;
+}
+
+/* 1 回の求解の区切り時刻 [ns] */
+typedef struct solve_clock {
+    long long t0;          /* 開始                         */
+    long long iterate;     /* Krylov 反復の開始            */
+    long long update;      /* 部分空間の更新・後片付けの開始 */
+} solve_clock_t;
+
+/* 毎反復の後に呼ぶ。 中断すべきなら 1。
+ * 進捗には元の系の相対残差 ‖r‖/‖b‖ を渡す (通知するときだけ計算する)。 */
+int  recycle_poll(cgnr_recycle_t* rec, int iter, const double* r, int len, double bnorm);
+
+/* 1 回の求解の統計を呼び出しスレッドの統計と rec (NULL 可) に加算。
+ * rec があれば rec->allocs も確保回数に含めて 0 に戻す */
+void recycle_record(cgnr_recycle_t* rec, const solve_clock_t* clk, int iter,
+                    long long spmv, long long allocations, double residual);
+
+#endif /* CGNR_RECYCLE_H_ */
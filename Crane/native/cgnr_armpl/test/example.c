@@ -1,6 +1,54 @@
+#include <math.h>
 #include <stdio.h>
 #include "../include/cgnr_solver.h"
 
+/* m×n 三重対角。 30 行ごとに σ≈1e-3 の弱い行 (ほぼメカニズム) を入れ、 s で少しずつ変える */
+static void drift_matrix(int m, int n, int s, int* rowptr, int* col, double* val)
+{
+    int nnz = 0;
+    for (int i = 0; i < m; ++i) {
+        rowptr[i] = nnz;
+        for (int j = i-1; j <= i+1; ++j) {
+            if (j < 0 || j >= n) continue;
+            int weak = i % 30 == 0 || j % 30 == 0;
+            double v = i == j ? (i % 30 == 0 ? 1e-3 : 1.0 + 0.05*i) : 0.3*sin(7.0*i + j)*(weak ? 1e-3 : 1.0);
+            col[nnz] = j;
+            val[nnz++] = v*(1.0 + 0.002*s);
+        }
+    }
+    rowptr[m] = nnz;
+}
+
+/* ドリフトする系列で通常版とリサイクル付きの反復回数の合計を比べる。
+ * リサイクル付きが 3/4 を超えたら (デフレーションが効いていなければ) 1 */
+static int drift_check(int m, int n)
+{
+    enum { N = 120, STEPS = 8 };
+    int rowptr[N+1], col[3*N];
+    double val[3*N], b[N], xp[N], xr[N];
+    long plain = 0, recycled = 0;
+    cgnr_recycle_t* rec = cgnr_recycle_create(8, 8);
+    for (int s = 0; s < STEPS; ++s) {
+        drift_matrix(m, n, s, rowptr, col, val);
+        for (int i = 0; i < m; ++i) b[i] = cos(3.0*i) + 0.01*s*sin(5.0*i*s);
+        for (int i = 0; i < n; ++i) xp[i] = xr[i] = 0;
+        int ip = cgnr_solve_lp64(m,n,rowptr,col,val,b,xp,1e-8,5000);
+        int ir = cgnr_solve_recycle_lp64(m,n,rowptr,col,val,b,xr,1e-8,5000,rec);
+        if (ip < 0 || ir < 0) { cgnr_recycle_destroy(rec); return 1; }
+        if (s > 0) { plain += ip; recycled += ir; }    /* 1 回目は W が空なので数えない */
+    }
+    cgnr_recycle_destroy(rec);
+    printf("drift %dx%d iterations plain=%ld recycled=%ld\n", m, n, plain, recycled);
+    return 4*recycled > 3*plain;
+}
+
+/* 1 反復目で中断を要求する進捗コールバック */
+static int on_progress(int iteration, double residual, void* user)
+{
+    printf("progress iter=%d  residual=%g\n", iteration, residual);
+    return ++*(int*)user >= 1;
+}
+
 int main(void)
 {
     /* 2×2 のテスト行列 [[4,1],[1,3]] */
@@ -9,6 +57,51 @@ int main(void)
 
     int it = cgnr_solve_lp64(m,n,rowptr,col,val,b,x,1e-12,100);
     printf("iter=%d  x=[%g,%g]\n", it, x[0], x[1]);
-    return 0;
+
+    /* リサイクル付き: 2 回目以降は保持した部分空間で即収束する */
+    cgnr_recycle_t* rec = cgnr_recycle_create(2, 2);
+    for (int s = 0; s < 2; ++s) {
+        x[0] = x[1] = 0;
+        it = cgnr_solve_recycle_lp64(m,n,rowptr,col,val,b,x,1e-12,100,rec);
+        printf("recycle iter=%d  x=[%g,%g]  k=%d\n", it, x[0], x[1], cgnr_recycle_size(rec));
+    }
+    cgnr_stats_t st;
+    cgnr_recycle_stats(rec, &st);
+    printf("stats solves=%lld iter=%lld spmv=%lld alloc=%lld time=%lldns"
+           " (setup=%lld iterate=%lld update=%lld)\n",
+           st.solves, st.iterations, st.spmv, st.allocations, st.solve_ns,
+           st.setup_ns, st.iterate_ns, st.update_ns);
+    cgnr_recycle_destroy(rec);
+
+    /* スレッド統計は通常版の求解も含む */
+    cgnr_thread_stats(&st);
+    printf("thread solves=%lld iter=%lld alloc=%lld\n", st.solves, st.iterations, st.allocations);
+
+    /* 劣決定 (2×3): A が変わっても通常版と同じ最小ノルム解を返す */
+    int    ru[3]={0,2,4}, cu[4]={0,1,1,2};
+    double vu[4]={1,1,1,1}, bu[2]={1,2}, diff=0;
+    rec = cgnr_recycle_create(2, 2);
+    for (int s = 0; s < 4; ++s) {
+        vu[3] = 1.0 + 0.5*s;
+        double xp[3]={0,0,0}, xr[3]={0,0,0};
+        cgnr_solve_lp64(2,3,ru,cu,vu,bu,xp,1e-12,100);
+        cgnr_solve_recycle_lp64(2,3,ru,cu,vu,bu,xr,1e-12,100,rec);
+        for (int i = 0; i < 3; ++i) diff = fmax(diff, fabs(xp[i]-xr[i]));
+    }
+    printf("underdetermined max|x - x_plain|=%.1e\n", diff);
+    cgnr_recycle_destroy(rec);
+
+    /* 監視付き: コールバックが 0 以外を返すと -4 で中断する */
+    int calls = 0;
+    rec = cgnr_recycle_create(2, 2);
+    cgnr_recycle_set_monitor(rec, on_progress, &calls, 1, NULL);
+    x[0] = x[1] = 0;
+    it = cgnr_solve_recycle_lp64(m,n,rowptr,col,val,b,x,1e-12,100,rec);
+    printf("monitored iter=%d  calls=%d\n", it, calls);
+    cgnr_recycle_destroy(rec);
+
+    /* ほぼ特異な系の列では W のデフレーションで反復が減る */
+    int fail = drift_check(120, 120) | drift_check(100, 120);
+    return fail;
 }
 
@@ -17,4 +17,85 @@ extern "C" DLL_API
 int cg_solve_csr_double(
     int n,
     const int* Ap,const int* Aj,const double* Ax,
-    const double* b,double* x,int maxIter,double tol);
\ No newline at end of file
+    const double* b,double* x,int maxIter,double tol);
+
+/* ───────────────────────────────────────────────────────── */
+/* Krylov 部分空間リサイクル (deflated CG / CGNR)
+ *   連続する求解の間で近特異ベクトル (メカニズム方向) の小さな部分空間を
+ *   保持し、次回以降の求解からデフレーションする。
+ *   ハンドルは 1 つの系列の求解専用。スレッド間で共有しないこと。 */
+typedef struct cgnr_recycle cgnr_recycle_t;
+
+extern "C" DLL_API
+cgnr_recycle_t* cgnr_recycle_create(int kmax, int lmax);
+extern "C" DLL_API
+void cgnr_recycle_destroy(cgnr_recycle_t* rec);
+extern "C" DLL_API
+void cgnr_recycle_reset(cgnr_recycle_t* rec);
+extern "C" DLL_API
+int  cgnr_recycle_size(const cgnr_recycle_t* rec);
+
+/* 求解統計 (テレメトリ)
+ *   リサイクル付きの求解ごとにハンドルへ累積される。
+ *   通常版を含むすべての求解は呼び出しスレッドごとにも累積される。 */
+typedef struct cgnr_stats {
+    long long solves;          /* 求解回数                          */
+    long long iterations;      /* Krylov 反復の累計                 */
+    long long spmv;            /* 疎行列ベクトル積の累計            */
+    long long allocations;     /* ヒープ確保回数の累計              */
+    long long solve_ns;        /* 求解時間の累計 [ns]               */
+    long long setup_ns;        /*  うち行列生成・部分空間の準備・初期残差 */
+    long long iterate_ns;      /*  うち Krylov 反復                 */
+    long long update_ns;       /*  うち部分空間の更新と後片付け     */
+    int       last_iterations; /* 直近の反復回数                    */
+    double    last_residual;   /* 直近の相対残差 ‖r‖/‖b‖            */
+} cgnr_stats_t;
+
+extern "C" DLL_API
+void cgnr_recycle_stats(const cgnr_recycle_t* rec, cgnr_stats_t* out);
+extern "C" DLL_API
+void cgnr_recycle_stats_reset(cgnr_recycle_t* rec);
+
+/* 呼び出しスレッドで実行したすべての求解の統計 (ハンドルのない通常版を含む) */
+extern "C" DLL_API
+void cgnr_thread_stats(cgnr_stats_t* out);
+extern "C" DLL_API
+void cgnr_thread_stats_reset();
+
+/* 呼び出しスレッドで MKL が使うスレッド数を設定し、 以前の値を返す。
+ *   0 でグローバル設定に戻す。 多数の独立した求解を並列に流す場合は
+ *   各ワーカースレッドで 1 を指定して MKL 内部の並列化を止める。
+ *   TBB スレッド層でも効くよう、 以後このスレッドの求解はその並列数の
+ *   TBB アリーナの中で実行する。 このライブラリの求解にだけ効く。 */
+extern "C" DLL_API
+int cgnr_set_blas_threads_local(int nthreads);
+
+/* 求解の監視 (進捗通知と中断)
+ *   progress は every 反復ごとに (反復回数, 元の系の相対残差 ‖b − A x‖/‖b‖) で呼ばれ、
+ *   0 以外を返すと求解を中断する。 cancel は毎反復読まれ、 0 以外なら中断する。
+ *   どちらも nullptr 可。 progress はソルバーを呼んだスレッドで呼ばれる。
+ *   中断した求解は -4 を返し (ArmPL 版と共通)、 x にはその時点の近似解が残る。
+ *   リサイクル付きの求解にだけ効く (rec == nullptr の通常版は監視しない)。 */
+typedef int (*cgnr_progress_fn)(int iteration, double residual, void* user);
+
+extern "C" DLL_API
+void cgnr_recycle_set_monitor(cgnr_recycle_t* rec,
+                              cgnr_progress_fn progress, void* user, int every,
+                              const volatile int* cancel);
+
+/* リサイクル付き CGNR。 通常版と同じく x は 0 から始め、 収束判定も
+ * ‖r‖/‖b‖ < tol だけを使う。 rec == nullptr なら通常の CGNR と同じ */
+extern "C" DLL_API
+int cgnr_solve_csr_double_recycle(
+    int m,int n,
+    const int* Ap,const int* Aj,const double* Ax,
+    const double* b,double* x,int maxIter,double tol,
+    cgnr_recycle_t* rec);
+
+/* リサイクル付き CG。 通常版と同じく x は 0 から始める */
+extern "C" DLL_API
+int cg_solve_csr_double_recycle(
+    int n,
+    const int* Ap,const int* Aj,const double* Ax,
+    const double* b,double* x,int maxIter,double tol,
+    cgnr_recycle_t* rec);
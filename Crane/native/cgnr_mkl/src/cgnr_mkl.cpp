@@ -1,5 +1,6 @@
 #define CGNRMKL_EXPORTS
 #include "../include/cgnr_mkl.h"
+#include "recycle.h"
 
 #include <mkl.h>
 #include <cmath>
@@ -7,7 +8,10 @@
 #include <cstring>
 
 
-enum { OK = 0, ERR_MKL = -1, ERR_ALLOC = -2, NO_CONV = 1 };
+enum { OK = 0, ERR_MKL = -1, ERR_ALLOC = -2, NO_CONV = 1, CANCELLED = -4 };
+
+/* リサイクル付き CGNR で Aᵀr を 0 とみなす水準 (‖Aᵀb‖ 比、 tol とは無関係) */
+static const double ROUNDOFF = 1e-14;
 
 static double dot(int n, const double* x, const double* y)
 {
@@ -26,7 +30,12 @@ cgnr_solve_csr_double(
         int   maxIter,
         double tol)
 {
+    int limited;
+    if(run_in_blas_arena(limited, [&]{ return cgnr_solve_csr_double(m,n,Ap,Aj,Ax,b,x,maxIter,tol); }))
+        return limited;
     if(m<=0||n<=0||!Ap||!Aj||!Ax||!b||!x) return ERR_ALLOC;
+    solve_clock_t clk{ recycle_now_ns() };
+    long long allocs = 0, spmv = 0;
 
     /* --- MKL Sparse handle ------------------------------------ */
     sparse_matrix_t A;
@@ -41,10 +50,10 @@ cgnr_solve_csr_double(
     matrix_descr desc; desc.type = SPARSE_MATRIX_TYPE_GENERAL;
 
     /* --- work vectors ----------------------------------------- */
-    double *r  = (double*)mkl_malloc(m*sizeof(double), 64);
-    double *z  = (double*)mkl_malloc(n*sizeof(double), 64);
-    double *p  = (double*)mkl_malloc(n*sizeof(double), 64);
-    double *q  = (double*)mkl_malloc(m*sizeof(double), 64);
+    double *r  = (double*)counted(&allocs, mkl_malloc(m*sizeof(double), 64));
+    double *z  = (double*)counted(&allocs, mkl_malloc(n*sizeof(double), 64));
+    double *p  = (double*)counted(&allocs, mkl_malloc(n*sizeof(double), 64));
+    double *q  = (double*)counted(&allocs, mkl_malloc(m*sizeof(double), 64));
     if(!r||!z||!p||!q){ mkl_free(r);mkl_free(z);mkl_free(p);mkl_free(q);
         mkl_sparse_destroy(A); return ERR_ALLOC; }
 
@@ -58,6 +67,9 @@ cgnr_solve_csr_double(
 
     double bNorm = sqrt(dot(m,b,b));  if(bNorm==0) bNorm=1.0;
     double rho   = dot(n,z,z);
+    double rNorm = bNorm;
+    spmv += 1;
+    clk.iterate = recycle_now_ns();
 
     int k=0;
     for(; k<maxIter; ++k)
@@ -66,6 +78,7 @@ cgnr_solve_csr_double(
         if(mkl_sparse_d_mv(SPARSE_OPERATION_NON_TRANSPOSE, 1.0, A, desc,
                            p, 0.0, q) != SPARSE_STATUS_SUCCESS)
             { k = -ERR_MKL; break; }
+        spmv += 1;
 
         double denom = dot(m,q,q);
         if(denom==0){ k = -ERR_MKL; break; }
@@ -79,13 +92,14 @@ cgnr_solve_csr_double(
         cblas_daxpy(m, -alpha, q, 1, r, 1);
 
         /* convergence */
-        double rNorm = sqrt(dot(m,r,r));
+        rNorm = sqrt(dot(m,r,r));
         if(rNorm / bNorm < tol) { k++; break; }
 
         /* z = Aᵀ r */
         if(mkl_sparse_d_mv(SPARSE_OPERATION_TRANSPOSE, 1.0, A, desc,
                            r, 0.0, z) != SPARSE_STATUS_SUCCESS)
             { k = -ERR_MKL; break; }
+        spmv += 1;
 
         double rho_new = dot(n,z,z);
         double beta = rho_new / rho;
@@ -97,8 +111,10 @@ cgnr_solve_csr_double(
     }
 
     /* clean */
+    clk.update = recycle_now_ns();
     mkl_free(r); mkl_free(z); mkl_free(p); mkl_free(q);
     mkl_sparse_destroy(A);
+    recycle_record(nullptr, clk, k, spmv, allocs, rNorm / bNorm);
 
     return (k<=0 || k>maxIter) ? NO_CONV : OK;
 }
@@ -114,7 +130,12 @@ cgnr_solve_csr_double(
      const double* b,double* x,
      int maxIter,double tol)
  {
+     int limited;
+     if(run_in_blas_arena(limited, [&]{ return cg_solve_csr_double(n,Ap,Aj,Ax,b,x,maxIter,tol); }))
+         return limited;
      if(n<=0||!Ap||!Aj||!Ax||!b||!x) return -1;
+     solve_clock_t clk{ recycle_now_ns() };
+     long long allocs = 0, spmv = 0;
  
      sparse_matrix_t A;
      if(mkl_sparse_d_create_csr(&A,SPARSE_INDEX_BASE_ZERO,
@@ -129,9 +150,9 @@ cgnr_solve_csr_double(
                        SPARSE_FILL_MODE_UPPER, /* 上三角 CSR と仮定 */
                        SPARSE_DIAG_NON_UNIT};
  
-     double *r=(double*)mkl_malloc(n*sizeof(double),64);
-     double *p=(double*)mkl_malloc(n*sizeof(double),64);
-     double *Apv=(double*)mkl_malloc(n*sizeof(double),64);
+     double *r=(double*)counted(&allocs, mkl_malloc(n*sizeof(double),64));
+     double *p=(double*)counted(&allocs, mkl_malloc(n*sizeof(double),64));
+     double *Apv=(double*)counted(&allocs, mkl_malloc(n*sizeof(double),64));
      if(!r||!p||!Apv){ mkl_sparse_destroy(A); return -3;}
  
      std::memset(x,0,n*sizeof(double));
@@ -140,12 +161,15 @@ cgnr_solve_csr_double(
      std::memcpy(p,r,n*sizeof(double));            /* p=r     */
      double rsold = cblas_ddot(n,r,1,r,1);
      double bnorm = std::sqrt(rsold); if(bnorm==0) bnorm=1;
+     clk.iterate = recycle_now_ns();
  
-     for(int k=0;k<maxIter;++k)
+     int rc = 1, k = 0;  /* 未収束 */
+     for(;k<maxIter;++k)
      {
          /* Ap = A p */
          mkl_sparse_d_mv(SPARSE_OPERATION_NON_TRANSPOSE,
                          1.0,A,desc,p,0.0,Apv);
+         spmv += 1;
  
          double alpha = rsold / cblas_ddot(n,p,1,Apv,1);
  
@@ -156,8 +180,7 @@ cgnr_solve_csr_double(
          cblas_daxpy(n,-alpha,Apv,1, r,1);
  
          double rsnew = cblas_ddot(n,r,1,r,1);
-         if(std::sqrt(rsnew)/bnorm < tol)
-         { mkl_free(r);mkl_free(p);mkl_free(Apv); mkl_sparse_destroy(A); return 0; }
+         if(std::sqrt(rsnew)/bnorm < tol){ rsold = rsnew; rc = 0; ++k; break; }
  
          double beta = rsnew / rsold;
          rsold = rsnew;
@@ -166,6 +189,228 @@ cgnr_solve_csr_double(
          cblas_dscal(n,beta,p,1);
          cblas_daxpy(n,1.0,r,1,p,1);
      }
+     clk.update = recycle_now_ns();
      mkl_free(r);mkl_free(p);mkl_free(Apv); mkl_sparse_destroy(A);
-     return 1;           /* 未収束 */
- }
\ No newline at end of file
+     recycle_record(nullptr, clk, k, spmv, allocs, std::sqrt(rsold)/bnorm);
+     return rc;
+ }
+
+
+/* =============================================================== *
+ *  Recycled (deflated) CGNR / CG                                  *
+ *  W 方向は粗空間で直接解き、 Krylov 反復からはデフレーションする   *
+ * =============================================================== */
+extern "C" DLL_API int
+cgnr_solve_csr_double_recycle(
+        int   m, int n,
+        const int*    Ap,
+        const int*    Aj,
+        const double* Ax,
+        const double* b,
+        double*       x,
+        int   maxIter,
+        double tol,
+        cgnr_recycle_t* rec)
+{
+    if(!rec) return cgnr_solve_csr_double(m,n,Ap,Aj,Ax,b,x,maxIter,tol);
+    int limited;
+    if(run_in_blas_arena(limited, [&]{ return cgnr_solve_csr_double_recycle(m,n,Ap,Aj,Ax,b,x,maxIter,tol,rec); }))
+        return limited;
+    if(m<=0||n<=0||!Ap||!Aj||!Ax||!b||!x) return ERR_ALLOC;
+    solve_clock_t clk{ recycle_now_ns() };
+    long long allocs = 0, spmv = 0;
+    if(recycle_prepare(rec, n, m)) return ERR_ALLOC;
+
+    sparse_matrix_t A;
+    if(mkl_sparse_d_create_csr(&A, SPARSE_INDEX_BASE_ZERO,
+            m, n,
+            const_cast<int*>(Ap),
+            const_cast<int*>(Ap+1),
+            const_cast<int*>(Aj),
+            const_cast<double*>(Ax)) != SPARSE_STATUS_SUCCESS)
+        return ERR_MKL;
+
+    matrix_descr desc; desc.type = SPARSE_MATRIX_TYPE_GENERAL;
+
+    double *r  = (double*)counted(&allocs, mkl_malloc(m*sizeof(double), 64));
+    double *z  = (double*)counted(&allocs, mkl_malloc(n*sizeof(double), 64));
+    double *p  = (double*)counted(&allocs, mkl_calloc(n, sizeof(double), 64));
+    double *pm = (double*)counted(&allocs, mkl_calloc(m, sizeof(double), 64));
+    double *q  = (double*)counted(&allocs, mkl_malloc(m*sizeof(double), 64));
+    if(!r||!z||!p||!pm||!q){ mkl_free(r);mkl_free(z);mkl_free(p);mkl_free(pm);mkl_free(q);
+        mkl_sparse_destroy(A); return ERR_ALLOC; }
+
+    /* A が変わると前回の W は null(A) 成分を含みうる。 粗空間補正がそれを x に
+     * 持ち込むと最小ノルム解から外れるので、 影から W = Aᵀ Wm を作り直して
+     * range(Aᵀ) に戻す (AᵀA を掛ける冪乗法と違い、 小さい固有値の方向を保つ)。 */
+    if(rec->k > 0){
+        for(int j=0;j<rec->k;++j)
+            mkl_sparse_d_mv(SPARSE_OPERATION_TRANSPOSE, 1.0, A, desc,
+                            rec->Wm+(size_t)j*m, 0.0, rec->W+(size_t)j*n);
+        spmv += rec->k;
+        recycle_range(rec);
+    }
+
+    /* MW = Aᵀ(A W) を現在の A で作り直す */
+    for(int j=0;j<rec->k;++j){
+        mkl_sparse_d_mv(SPARSE_OPERATION_NON_TRANSPOSE, 1.0, A, desc,
+                        rec->W+(size_t)j*n, 0.0, q);
+        mkl_sparse_d_mv(SPARSE_OPERATION_TRANSPOSE, 1.0, A, desc,
+                        q, 0.0, rec->MW+(size_t)j*n);
+    }
+    spmv += 2*rec->k;
+    recycle_factor(rec);
+
+    /* 通常版と同じく x0 = 0:  r = b,  z = Aᵀ r */
+    std::memset(x, 0, n*sizeof(double));
+    std::memcpy(r, b, m*sizeof(double));
+    mkl_sparse_d_mv(SPARSE_OPERATION_TRANSPOSE, 1.0, A, desc, r, 0.0, z);
+    double zNorm0 = sqrt(dot(n,z,z));
+    spmv += 1;
+
+    /* 粗空間補正 x += W G⁻¹ Wᵀ z */
+    if(rec->k > 0){
+        recycle_coarse(rec, z, x);
+        std::memcpy(r, b, m*sizeof(double));
+        mkl_sparse_d_mv(SPARSE_OPERATION_NON_TRANSPOSE, -1.0, A, desc, x, 1.0, r);
+        mkl_sparse_d_mv(SPARSE_OPERATION_TRANSPOSE, 1.0, A, desc, r, 0.0, z);
+        spmv += 2;
+    }
+    recycle_project(rec, z, p, r, pm, 0.0);        /* p = z - W G⁻¹ MWᵀ z,  pm = r - Wm G⁻¹ MWᵀ z */
+
+    double bNorm = sqrt(dot(m,b,b));  if(bNorm==0) bNorm=1.0;
+    double rNorm = sqrt(dot(m,r,r));
+    double rho   = dot(n,z,z);
+    clk.iterate = recycle_now_ns();
+
+    int rc = NO_CONV, k = 0;
+    if(rNorm / bNorm < tol || sqrt(rho) <= ROUNDOFF*zNorm0) rc = OK;   /* 粗空間補正だけで解けた */
+    for(; rc == NO_CONV && k<maxIter; ++k)
+    {
+        if(mkl_sparse_d_mv(SPARSE_OPERATION_NON_TRANSPOSE, 1.0, A, desc,
+                           p, 0.0, q) != SPARSE_STATUS_SUCCESS)
+            { rc = ERR_MKL; break; }
+
+        spmv += 1;
+
+        double denom = dot(m,q,q);
+        /* 通常版と同じく、 A p = 0 は最小二乗解に達したものとみなす */
+        if(denom==0){ rc = OK; break; }
+        recycle_harvest(rec, p, pm, denom);
+
+        double alpha = rho / denom;
+        cblas_daxpy(n, alpha, p, 1, x, 1);
+        cblas_daxpy(m, -alpha, q, 1, r, 1);
+
+        rNorm = sqrt(dot(m,r,r));
+        if(rNorm / bNorm < tol) { rc = OK; ++k; break; }
+
+        if(mkl_sparse_d_mv(SPARSE_OPERATION_TRANSPOSE, 1.0, A, desc,
+                           r, 0.0, z) != SPARSE_STATUS_SUCCESS)
+            { rc = ERR_MKL; break; }
+        spmv += 1;
+
+        /* Aᵀr が丸め誤差の水準まで落ちたら最小二乗解に達している (非適合な系)。
+         * ここから先は探索方向が丸め誤差だけになり、 デフレーションで増幅される */
+        double rho_new = dot(n,z,z);
+        if(sqrt(rho_new) <= ROUNDOFF*zNorm0) { rc = OK; ++k; break; }
+        if(recycle_poll(rec, k+1, r, m, bNorm)) { rc = CANCELLED; ++k; break; }
+
+        recycle_project(rec, z, p, r, pm, rho_new / rho);
+        rho = rho_new;
+    }
+    clk.update = recycle_now_ns();
+    if(rc != ERR_MKL && rc != CANCELLED) recycle_update(rec);
+
+    mkl_free(r); mkl_free(z); mkl_free(p); mkl_free(pm); mkl_free(q);
+    mkl_sparse_destroy(A);
+    recycle_record(rec, clk, k, spmv, allocs, rNorm / bNorm);
+
+    if(rc == CANCELLED) return CANCELLED;
+    return rc == OK ? OK : NO_CONV;
+}
+
+extern "C" DLL_API
+int cg_solve_csr_double_recycle(
+    int n,
+    const int* Ap,const int* Aj,const double* Ax,
+    const double* b,double* x,
+    int maxIter,double tol,
+    cgnr_recycle_t* rec)
+{
+    if(!rec) return cg_solve_csr_double(n,Ap,Aj,Ax,b,x,maxIter,tol);
+    int limited;
+    if(run_in_blas_arena(limited, [&]{ return cg_solve_csr_double_recycle(n,Ap,Aj,Ax,b,x,maxIter,tol,rec); }))
+        return limited;
+    if(n<=0||!Ap||!Aj||!Ax||!b||!x) return -1;
+    solve_clock_t clk{ recycle_now_ns() };
+    long long allocs = 0, spmv = 0;
+    if(recycle_prepare(rec, n, 0)) return -3;
+
+    sparse_matrix_t A;
+    if(mkl_sparse_d_create_csr(&A,SPARSE_INDEX_BASE_ZERO,
+            n,n,
+            const_cast<int*>(Ap),
+            const_cast<int*>(Ap+1),
+            const_cast<int*>(Aj),
+            const_cast<double*>(Ax))!=SPARSE_STATUS_SUCCESS)
+        return -2;
+    matrix_descr desc{SPARSE_MATRIX_TYPE_SYMMETRIC,
+                      SPARSE_FILL_MODE_UPPER,
+                      SPARSE_DIAG_NON_UNIT};
+
+    double *r=(double*)counted(&allocs, mkl_malloc(n*sizeof(double),64));
+    double *p=(double*)counted(&allocs, mkl_calloc(n,sizeof(double),64));
+    double *Apv=(double*)counted(&allocs, mkl_malloc(n*sizeof(double),64));
+    if(!r||!p||!Apv){ mkl_free(r);mkl_free(p);mkl_free(Apv); mkl_sparse_destroy(A); return -3;}
+
+    /* MW = A W */
+    for(int j=0;j<rec->k;++j)
+        mkl_sparse_d_mv(SPARSE_OPERATION_NON_TRANSPOSE,
+                        1.0,A,desc,rec->W+(size_t)j*n,0.0,rec->MW+(size_t)j*n);
+    spmv += rec->k;
+    recycle_factor(rec);
+
+    std::memset(x,0,n*sizeof(double));                   /* 通常版と同じく x0 = 0 */
+    std::memcpy(r,b,n*sizeof(double));                    /* r=b-Ax0 */
+    if(rec->k > 0){                                       /* 粗空間補正 */
+        recycle_coarse(rec, r, x);
+        std::memcpy(r,b,n*sizeof(double));
+        mkl_sparse_d_mv(SPARSE_OPERATION_NON_TRANSPOSE,-1.0,A,desc,x,1.0,r);
+        spmv += 1;
+    }
+    recycle_project(rec, r, p, nullptr, nullptr, 0.0);
+
+    double rsold = cblas_ddot(n,r,1,r,1);
+    double bnorm = std::sqrt(cblas_ddot(n,b,1,b,1)); if(bnorm==0) bnorm=1;
+    clk.iterate = recycle_now_ns();
+
+    int rc = 1, k = 0;    /* 未収束 */
+    if(std::sqrt(rsold)/bnorm < tol) rc = 0;              /* 粗空間補正だけで解けた */
+    for(;rc == 1 && k<maxIter;++k)
+    {
+        mkl_sparse_d_mv(SPARSE_OPERATION_NON_TRANSPOSE,
+                        1.0,A,desc,p,0.0,Apv);
+        spmv += 1;
+
+        double pAp = cblas_ddot(n,p,1,Apv,1);
+        recycle_harvest(rec, p, nullptr, pAp);
+        double alpha = rsold / pAp;
+
+        cblas_daxpy(n, alpha, p,1, x,1);
+        cblas_daxpy(n,-alpha,Apv,1, r,1);
+
+        double rsnew = cblas_ddot(n,r,1,r,1);
+        if(std::sqrt(rsnew)/bnorm < tol){ rsold = rsnew; rc = 0; ++k; break; }
+        if(recycle_poll(rec, k+1, r, n, bnorm)){ rsold = rsnew; rc = CANCELLED; ++k; break; }
+
+        recycle_project(rec, r, p, nullptr, nullptr, rsnew/rsold);
+        rsold = rsnew;
+    }
+    clk.update = recycle_now_ns();
+    if(rc != CANCELLED) recycle_update(rec);
+
+    mkl_free(r);mkl_free(p);mkl_free(Apv); mkl_sparse_destroy(A);
+    recycle_record(rec, clk, k, spmv, allocs, std::sqrt(rsold)/bnorm);
+    return rc;
+}
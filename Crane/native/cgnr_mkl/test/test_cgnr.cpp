@@ -1,6 +1,50 @@
 #include "../include/cgnr_mkl.h"
 #include <cstdio>
 #include <vector>
+#include <algorithm>
+#include <cmath>
+
+/* m×n 三重対角。 30 行ごとに σ≈1e-3 の弱い行 (ほぼメカニズム) を入れ、 s で少しずつ変える */
+static void drift_matrix(int m, int n, int s, std::vector<int>& Ap, std::vector<int>& Aj, std::vector<double>& Ax)
+{
+    Ap.assign(1, 0); Aj.clear(); Ax.clear();
+    for(int i=0;i<m;++i){
+        for(int j=i-1;j<=i+1;++j){
+            if(j<0||j>=n) continue;
+            bool weak = i%30==0 || j%30==0;
+            double v = i==j ? (i%30==0 ? 1e-3 : 1.0+0.05*i) : 0.3*std::sin(7.0*i+j)*(weak ? 1e-3 : 1.0);
+            Aj.push_back(j);
+            Ax.push_back(v*(1.0+0.002*s));
+        }
+        Ap.push_back((int)Aj.size());
+    }
+}
+
+/* ドリフトする系列で通常版とリサイクル付きの反復回数の合計を比べる。
+ * リサイクル付きが 3/4 を超えたら (デフレーションが効いていなければ) false */
+static bool drift_check(int m, int n)
+{
+    std::vector<int> Ap, Aj;
+    std::vector<double> Ax, b(m), xp(n), xr(n);
+    long long plain = 0, recycled = 0;
+    cgnr_stats_t st;
+    cgnr_recycle_t* rec = cgnr_recycle_create(8,8);
+    for(int s=0;s<8;++s){
+        drift_matrix(m,n,s,Ap,Aj,Ax);
+        for(int i=0;i<m;++i) b[i] = std::cos(3.0*i) + 0.01*s*std::sin(5.0*i*s);
+        int rp = cgnr_solve_csr_double(m,n, Ap.data(),Aj.data(),Ax.data(), b.data(), xp.data(), 5000, 1e-8);
+        cgnr_thread_stats(&st);
+        int ip = st.last_iterations;
+        int rr = cgnr_solve_csr_double_recycle(m,n, Ap.data(),Aj.data(),Ax.data(), b.data(), xr.data(), 5000, 1e-8, rec);
+        cgnr_thread_stats(&st);
+        int ir = st.last_iterations;
+        if(rp!=0 || rr!=0){ cgnr_recycle_destroy(rec); return false; }
+        if(s>0){ plain += ip; recycled += ir; }    /* 1 回目は W が空なので数えない */
+    }
+    cgnr_recycle_destroy(rec);
+    std::printf("drift %dx%d iterations plain=%lld recycled=%lld\n", m, n, plain, recycled);
+    return 4*recycled <= 3*plain;
+}
 
 int main()
 {
@@ -20,4 +64,58 @@ int main()
 
     if(rc!=0){ std::printf("CGNR failed %d\n",rc); return 1; }
     std::printf("x = [%.6f, %.6f]\n", x[0],x[1]); // ≈ [1,3.75]
+
+    /* リサイクル付き: 同じ系を 2 回解く */
+    cgnr_recycle_t* rec = cgnr_recycle_create(2,2);
+    for(int s=0;s<2;++s){
+        std::fill(x.begin(), x.end(), 0.0);
+        rc = cgnr_solve_csr_double_recycle(
+            m,n, Ap,Aj,Ax,
+            b, x.data(),
+            1000, 1e-8, rec);
+        if(rc!=0){ std::printf("recycled CGNR failed %d\n",rc); return 1; }
+        std::printf("recycle x = [%.6f, %.6f] k=%d\n", x[0],x[1], cgnr_recycle_size(rec));
+    }
+    cgnr_stats_t st;
+    cgnr_recycle_stats(rec,&st);
+    std::printf("stats solves=%lld iter=%lld spmv=%lld alloc=%lld (setup=%lld iterate=%lld update=%lld ns)\n",
+                st.solves, st.iterations, st.spmv, st.allocations, st.setup_ns, st.iterate_ns, st.update_ns);
+    cgnr_thread_stats(&st);
+    std::printf("thread solves=%lld iter=%lld alloc=%lld\n", st.solves, st.iterations, st.allocations);
+    cgnr_recycle_destroy(rec);
+
+    /* 劣決定 (2×3): A が変わっても通常版と同じ最小ノルム解を返す */
+    int Bp[]={0,2,4}, Bj[]={0,1,1,2};
+    double Bx[]={1,1,1,1}, c[]={1,2};
+    rec = cgnr_recycle_create(2,2);
+    double diff = 0;
+    for(int s=0;s<4;++s){
+        Bx[3] = 1.0 + 0.5*s;
+        double xp[3], xr[3];
+        cgnr_solve_csr_double(2,3, Bp,Bj,Bx, c, xp, 1000, 1e-12);
+        cgnr_solve_csr_double_recycle(2,3, Bp,Bj,Bx, c, xr, 1000, 1e-12, rec);
+        for(int i=0;i<3;++i) diff = std::max(diff, std::abs(xp[i]-xr[i]));
+    }
+    std::printf("underdetermined max|x - x_plain| = %.1e\n", diff);
+    cgnr_recycle_destroy(rec);
+
+    /* 中断フラグが立っていれば 1 反復目の後で -4 を返す */
+    volatile int cancel = 1;
+    rec = cgnr_recycle_create(2,2);
+    cgnr_recycle_set_monitor(rec, nullptr, nullptr, 0, &cancel);
+    std::fill(x.begin(), x.end(), 0.0);
+    rc = cgnr_solve_csr_double_recycle(m,n, Ap,Aj,Ax, b, x.data(), 1000, 1e-8, rec);
+    cgnr_recycle_stats(rec,&st);
+    std::printf("cancelled rc=%d iter=%d\n", rc, st.last_iterations);
+    cgnr_recycle_destroy(rec);
+
+    /* 並列数を 1 に制限しても同じ解になる */
+    cgnr_set_blas_threads_local(1);
+    std::fill(x.begin(), x.end(), 0.0);
+    rc = cgnr_solve_csr_double(m,n, Ap,Aj,Ax, b, x.data(), 1000, 1e-8);
+    cgnr_set_blas_threads_local(0);
+    std::printf("1 thread x = [%f, %f]\n", x[0], x[1]);
+
+    /* ほぼ特異な系の列では W のデフレーションで反復が減る */
+    if(!drift_check(120,120) || !drift_check(100,120)){ std::printf("recycling did not reduce iterations\n"); return 1; }
 }
\ No newline at end of file
@@ -16,4 +16,8 @@ DLL_API int gram_mkl_build_lp64(
     double w,
     int **Cp, int **Cj, double **Cx
 );
+
+/* 呼び出しスレッドで MKL が使うスレッド数を設定し、 以前の値を返す (0 で既定に戻す)。
+ * 以後このスレッドの gram_mkl_build_lp64 はその並列数の TBB アリーナの中で実行する。 */
+DLL_API int gram_set_blas_threads_local(int nthreads);
 }
@@ -4,9 +4,25 @@
 #include <mkl.h>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
+#include <tbb/task_arena.h>
 
 enum { OK=0, ERR_MKL=-1, ERR_ALLOC=-2, ERR_ARG=-3 };
 
+/* gram_set_blas_threads_local の設定 (呼び出しスレッドごと)。
+ * TBB スレッド層の MKL はアリーナの並列数で動くので、 アリーナでも抑える */
+static thread_local int  blas_limit  = 0;       /* 0 = 制限なし */
+static thread_local bool blas_inside = false;
+static thread_local std::unique_ptr<tbb::task_arena> blas_arena;
+
+extern "C"
+DLL_API int gram_set_blas_threads_local(int nthreads)
+{
+    if(nthreads!=blas_limit) blas_arena.reset();
+    blas_limit = nthreads>0 ? nthreads : 0;
+    return mkl_set_num_threads_local(nthreads);
+}
+
 /* CSR -> MKL handle ------------------------------------------------*/
 static sparse_matrix_t csr2handle(
         MKL_INT m,MKL_INT n,
@@ -85,6 +101,14 @@ DLL_API int gram_mkl_build_lp64(
     double w,
     int** Cp,int** Cj,double** Cv)
 {
+    if(blas_limit>0 && !blas_inside){
+        if(!blas_arena) blas_arena.reset(new tbb::task_arena(blas_limit));
+        blas_inside = true;
+        int rc = blas_arena->execute([&]{
+            return gram_mkl_build_lp64(mA,n,Ap,Aj,Ax,mB,Bp,Bj,Bx,w,Cp,Cj,Cv); });
+        blas_inside = false;
+        return rc;
+    }
     if(w<=0.0||!Ap||!Bp||n<=0) return ERR_ARG;
 
     sparse_matrix_t A=nullptr,B=nullptr,AtA=nullptr,BtB=nullptr;